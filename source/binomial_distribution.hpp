@@ -0,0 +1,170 @@
+#pragma once
+
+// we use binomial distribution to hand out the remaining traces of ParetoAllocator
+// a multinomial draw over g groups is g conditional binomial draws
+// the sampler takes O(1) expected time for any n, so the remaining traces are not handed out one by one
+// 1. if np < 10, we use the inversion algorithm (sequential search from 0, O(np) expected)
+// 2. otherwise, we use the transformed rejection with decomposition (BTRD) algorithm
+//    W. Hormann, The generation of binomial random variates, 1993
+// p > 0.5 is reduced to n - Binomial(n, 1 - p)
+
+#include <cmath>
+
+#include "random.hpp"
+
+namespace flowbench {
+
+class BinomialDistribution {
+private:
+    constexpr static double INVERSION_MEAN = 10.0;
+
+    uint32_t n;
+    double p;
+    bool flipped;
+
+    // the parameters of BTRD
+    uint32_t m = 0;
+    double r = 0.0, nr = 0.0, npq = 0.0, b = 0.0, a = 0.0, c = 0.0, alpha = 0.0, vr = 0.0, urvr = 0.0;
+
+    // the correction term of Stirling's formula, log(k!) - log(sqrt(2 pi)) - (k + 0.5) log(k + 1) + (k + 1)
+    static double stirlingCorrection(uint32_t k);
+
+    double nextDouble() const {
+        return Random::getInstance().nextDouble(0.0, 1.0);
+    }
+
+    uint32_t inversion() const;
+    uint32_t transformedRejection() const;
+
+public:
+    BinomialDistribution(uint32_t n, double p);
+
+    uint32_t sample() const {
+        if (n == 0 || p <= 0.0) {
+            return flipped ? n : 0;
+        }
+        uint32_t k = n * p < INVERSION_MEAN ? inversion() : transformedRejection();
+        return flipped ? n - k : k;
+    }
+};
+
+constexpr double BinomialDistribution::INVERSION_MEAN;
+
+BinomialDistribution::BinomialDistribution(uint32_t n, double p) : n(n), p(p), flipped(false) {
+    if (this->p > 0.5) {
+        this->p = 1.0 - this->p;
+        flipped = true;
+    }
+    if (n * this->p >= INVERSION_MEAN) {
+        double q = 1.0 - this->p;
+        double sqrtNpq = std::sqrt(n * this->p * q);
+        m = static_cast<uint32_t>((n + 1) * this->p);
+        r = this->p / q;
+        nr = (n + 1) * r;
+        npq = n * this->p * q;
+        b = 1.15 + 2.53 * sqrtNpq;
+        a = -0.0873 + 0.0248 * b + 0.01 * this->p;
+        c = n * this->p + 0.5;
+        alpha = (2.83 + 5.1 / b) * sqrtNpq;
+        vr = 0.92 - 4.2 / b;
+        urvr = 0.86 * vr;
+    }
+}
+
+double BinomialDistribution::stirlingCorrection(uint32_t k) {
+    static const double table[] = {
+        0.08106146679532726, 0.04134069595540929, 0.02767792568499834, 0.02079067210376509,
+        0.01664469118982119, 0.01387612882307075, 0.01189670994589177, 0.01041126526197209,
+        0.009255462182712733, 0.008330563433362871
+    };
+    if (k < 10) {
+        return table[k];
+    }
+    double t = 1.0 / (k + 1.0);
+    double tt = t * t;
+    return (1.0 / 12 - (1.0 / 360 - 1.0 / 1260 * tt) * tt) * t;
+}
+
+uint32_t BinomialDistribution::inversion() const {
+    double q = 1.0 - p;
+    double s = p / q;
+    double t = (n + 1) * s;
+    while (true) {
+        double f = std::pow(q, n);
+        double u = nextDouble();
+        uint32_t k = 0;
+        while (u > f) {
+            u -= f;
+            k++;
+            if (k > n) { // rounding error, try again
+                break;
+            }
+            f *= t / k - s;
+        }
+        if (k <= n) {
+            return k;
+        }
+    }
+}
+
+uint32_t BinomialDistribution::transformedRejection() const {
+    while (true) {
+        double v = nextDouble();
+        double u;
+        if (v <= urvr) {
+            u = v / vr - 0.43;
+            return static_cast<uint32_t>(std::floor((2 * a / (0.5 - std::fabs(u)) + b) * u + c));
+        }
+        if (v >= vr) {
+            u = nextDouble() - 0.5;
+        } else {
+            u = v / vr - 0.93;
+            u = (u < 0 ? -0.5 : 0.5) - u;
+            v = nextDouble() * vr;
+        }
+        double us = 0.5 - std::fabs(u);
+        double kf = std::floor((2 * a / us + b) * u + c);
+        if (kf < 0 || kf > n) {
+            continue;
+        }
+        uint32_t k = static_cast<uint32_t>(kf);
+        v = v * alpha / (a / (us * us) + b);
+        uint32_t km = k > m ? k - m : m - k;
+        if (km <= 15) {
+            // recursive evaluation of f(k) / f(m)
+            double f = 1.0;
+            if (m < k) {
+                for (uint32_t i = m + 1; i <= k; i++) {
+                    f *= nr / i - r;
+                }
+            } else {
+                for (uint32_t i = k + 1; i <= m; i++) {
+                    v *= nr / i - r;
+                }
+            }
+            if (v <= f) {
+                return k;
+            }
+            continue;
+        }
+        // squeeze with the normal approximation, then the exact test with Stirling's formula
+        v = std::log(v);
+        double rho = (km / npq) * (((km / 3.0 + 0.625) * km + 1.0 / 6) / npq + 0.5);
+        double t = -(double)km * km / (2 * npq);
+        if (v < t - rho) {
+            return k;
+        }
+        if (v > t + rho) {
+            continue;
+        }
+        double nm = n - m + 1.0;
+        double h = (m + 0.5) * std::log((m + 1) / (r * nm)) + stirlingCorrection(m) + stirlingCorrection(n - m);
+        double nk = n - k + 1.0;
+        if (v <= h + (n + 1) * std::log(nm / nk) + (k + 0.5) * std::log(nk * r / (k + 1)) -
+                  stirlingCorrection(k) - stirlingCorrection(n - k)) {
+            return k;
+        }
+    }
+}
+
+}
\ No newline at end of file
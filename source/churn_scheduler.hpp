@@ -0,0 +1,132 @@
+#pragma once
+
+// order the packets of the trace by flow churn (--churn)
+// in real traffic, flows start and end, so the set of active flows drifts over the trace
+// the time is counted in packets (the trace has about one packet per unit of time)
+// 1. the flows arrive by a Poisson process in a random order (a keyed permutation, see feistel_permutation.hpp)
+//    the rate is F / N flows per unit of time, so all the F flows arrive during the N packets
+// 2. every flow lives for a lifetime drawn from the distribution (in units of time, see count_distribution.hpp)
+//    and its packets are at uniformly random times during its lifetime
+// 3. the packets of the active flows are output in the order of time
+// the number of packets of every flow is kept, and the mean number of active flows is F / N * E[lifetime]
+// the scheduler keeps only the next packet of every active flow in a heap, generated when the previous one is output
+// (the sorted uniform times are generated one by one), so the memory is bounded by the active set
+// and the order is the same whether the packets are stored or streamed (see Trace::visitPackets)
+// the scheduler draws from its own random engine (SplitMix64) seeded by the seed, so the order only depends on the seed
+// and the random engine of the thread is left untouched (the scheduler also runs while the trace is printed)
+
+#include <cmath>
+#include <queue>
+#include <vector>
+
+#include "count_distribution.hpp"
+#include "feistel_permutation.hpp"
+
+namespace flowbench {
+
+class ChurnScheduler {
+private:
+    constexpr static uint32_t BLOCK_SIZE = 4096;
+
+    // SplitMix64, the high 32 bits of every output
+    class Engine : public UniformSource {
+    private:
+        uint64_t state;
+
+    public:
+        Engine(uint32_t seed) : state(static_cast<uint64_t>(seed) << 32 | seed) {}
+
+        uint32_t nextUInt32() override {
+            uint64_t x = state += 0x9e3779b97f4a7c15ull;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return (x ^ (x >> 31)) >> 32;
+        }
+    };
+
+    // the next packet of an active flow
+    struct Event {
+        double time;
+        double end; // the end of the lifetime of the flow
+        uint32_t flowId;
+        uint32_t remain; // the number of packets left after this one
+
+        bool operator>(const Event& other) const {
+            return time > other.time || (time == other.time && flowId > other.flowId);
+        }
+    };
+
+    const std::vector<uint32_t>& flowEnds;
+    const CountDistribution& lifetimeDistribution;
+    FeistelPermutation arrivalOrder;
+    Engine engine;
+    double rate;
+
+    uint32_t arrivalCount = 0;
+    double arrivalTime = 0.0;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+
+    std::vector<uint32_t> lifetimes;
+    uint32_t usedLifetimes = BLOCK_SIZE;
+
+    double nextUniform() {
+        return engine.nextDouble(0.0, 1.0);
+    }
+
+    // the first of count uniformly random times in [time, end)
+    double nextTime(double time, double end, uint32_t count) {
+        return time + (end - time) * (1.0 - std::pow(nextUniform(), 1.0 / count));
+    }
+
+    void arrive();
+
+public:
+    // flowEnds: the end of the packets of every flow (prefix sums)
+    ChurnScheduler(const std::vector<uint32_t>& flowEnds, const CountDistribution& lifetimeDistribution, uint32_t seed);
+
+    // the flow ID of the next packet (there should be packets left)
+    uint32_t next();
+
+    // the number of active flows
+    uint32_t getActiveCount() const {
+        return events.size();
+    }
+};
+
+constexpr uint32_t ChurnScheduler::BLOCK_SIZE;
+
+ChurnScheduler::ChurnScheduler(const std::vector<uint32_t>& flowEnds, const CountDistribution& lifetimeDistribution, uint32_t seed)
+    : flowEnds(flowEnds), lifetimeDistribution(lifetimeDistribution),
+      arrivalOrder(flowEnds.size(), static_cast<uint64_t>(seed) << 32 | ~seed), engine(seed), lifetimes(BLOCK_SIZE) {
+    uint32_t packetCount = flowEnds.empty() ? 0 : flowEnds.back();
+    rate = packetCount == 0 ? 1.0 : static_cast<double>(flowEnds.size()) / packetCount;
+}
+
+void ChurnScheduler::arrive() {
+    uint32_t flowId = arrivalOrder(arrivalCount++);
+    uint32_t count = flowEnds[flowId] - (flowId == 0 ? 0 : flowEnds[flowId - 1]);
+    if (usedLifetimes == BLOCK_SIZE) {
+        lifetimeDistribution.fill(lifetimes, engine);
+        usedLifetimes = 0;
+    }
+    double end = arrivalTime + lifetimes[usedLifetimes++];
+    if (count > 0) {
+        events.push(Event{ nextTime(arrivalTime, end, count), end, flowId, count - 1 });
+    }
+    arrivalTime -= std::log(1.0 - engine.nextDouble(0.0, 1.0 - 1e-9)) / rate;
+}
+
+uint32_t ChurnScheduler::next() {
+    // the flows arriving before the next packet become active
+    while (arrivalCount < flowEnds.size() && (events.empty() || arrivalTime <= events.top().time)) {
+        arrive();
+    }
+    Event event = events.top();
+    events.pop();
+    if (event.remain > 0) {
+        events.push(Event{ nextTime(event.time, event.end, event.remain), event.end, event.flowId, event.remain - 1 });
+    }
+    return event.flowId;
+}
+
+}
\ No newline at end of file
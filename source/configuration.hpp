@@ -41,6 +41,9 @@ private:
     // whether enable dense mode
     bool enableDenseMode = false;
 
+    // whether solve the recursive tree in the depth-first order (--dfs)
+    bool enableDepthFirst = false;
+
     // whether use pre-defined protocol is set in RuleTypeUd (-p)
 
 public:
@@ -78,6 +81,10 @@ public:
         return enableArbitraryRange;
     }
 
+    bool isEnableDepthFirst() const {
+        return enableDepthFirst;
+    }
+
     const char* getQuadDagFilePath() const {
         if (enableDenseMode) {
             return DENSE_PROFILE_PATH;
@@ -132,6 +139,8 @@ Configuration::Configuration(int argc, char* argv[]) {
             enableArbitraryRange = true;
         } else if (strcmp(argv[i], "--dense") == 0) {
             enableDenseMode = true;
+        } else if (strcmp(argv[i], "--dfs") == 0) {
+            enableDepthFirst = true;
         } else if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--protocol") == 0) {
             RuleTypeUD::getInstance().setProtocol(getEnumValue<Protocol>(argv[++i]));
         } else {
@@ -194,6 +203,7 @@ void Configuration::print(std::ostream& os) const {
     os << "outputStyle: " << getEnumName(outputStyle) << std::endl;
     os << "enableArbitraryRange: " << enableArbitraryRange << std::endl;
     os << "enableDenseMode: " << enableDenseMode << std::endl;
+    os << "enableDepthFirst: " << enableDepthFirst << std::endl;
 }
 
 }
\ No newline at end of file
@@ -4,18 +4,22 @@
 // (for trace generator)
 // the parameters we support can be found in the document
 
+#include <algorithm>
 #include <iostream>
 #include <cstring>
+#include <thread>
 #include <vector>
 
 #include "singleton.hpp"
 #include "protocol.hpp"
 #include "rule_format.hpp"
 #include "pareto_distribution.hpp"
+#include "rate_model.hpp"
+#include "zipf_distribution.hpp"
 
 namespace flowbench {
 
-class TraceConfiguration : public Singleton<TraceConfiguration> {
+class TraceConfiguration : public ThreadLocalSingleton<TraceConfiguration> {
 private:
     // the number of traces in the flow table (-n)
     uint32_t traceCount = 0;
@@ -34,7 +38,28 @@ private:
 
     // the user-defined protocol is set in RuleTypeUd (-f, -fw, -ft)
 
-    // the spatial locality of the traces is set in ParetoDistribution (-rd, -fd)
+    // the spatial locality of the rules and the flows (-rd, -fd)
+    // Pareto by default, or Zipf (-rd zipf:s[:N])
+    std::unique_ptr<CountDistribution> ruleDistribution = std::make_unique<ParetoDistribution>(0.0, 0.0);
+    std::unique_ptr<CountDistribution> flowDistribution = std::make_unique<ParetoDistribution>(1.0, 1.0);
+
+    // the temporal locality of the packets (--temporal), the distribution of the LRU stack distances plus 1
+    // nullptr means the packets are shuffled uniformly
+    std::unique_ptr<CountDistribution> temporalDistribution;
+
+    // the flow churn of the packets (--churn), the distribution of the lifetimes of the flows (in packets)
+    // nullptr means all the flows are active during the whole trace
+    std::unique_ptr<CountDistribution> lifetimeDistribution;
+
+    // the ratio of the packets which miss the rules (--miss-ratio, see miss_generator.hpp)
+    double missRatio = 0.0;
+
+    // the number of overlapping rules matched by every flow (--overlap-depth, see overlap_sampler.hpp)
+    // 0 or 1 means the flows are drawn anywhere in their rules
+    uint32_t overlapDepth = 0;
+
+    // the timestamps of the packets in the binary trace and the pcap file (--rate, see rate_model.hpp)
+    RateModel rateModel;
 
     // the random seed (-s)
     uint32_t randomSeed = 5489;
@@ -42,19 +67,73 @@ private:
     // user-defined output style (--flowbench/--classbench)
     RuleOutputStyle outputStyle = RuleOutputStyle::FlowBench;
 
-    // enable fast mode (--fast)
+    // output the trace as a binary trace (--binary, see trace_reader.hpp)
+    bool binaryOutput = false;
+
+    // output the trace as packets in a pcap file (--pcap, see pcap_writer.hpp)
+    // only for the pre-defined protocols (-p)
+    bool pcapOutput = false;
+
+    // enable fast mode (--fast, or if the rule distribution is not specified)
+    bool fastModeSpecified = false;
     bool fastMode = false;
 
+    // enable rejection mode (--rejection)
+    // the flows are drawn by rejection sampling instead of building the isolate rule set
+    bool rejectionModeSpecified = false;
+    bool rejectionMode = false;
+
+    // enable the cache of the isolate rule set (--cache)
+    bool cacheEnabled = false;
+
+    // the number of threads used to build the isolate rule set (-t, --threads)
+    // (also the number of jobs running concurrently in batch mode)
+    // 0 means the number of hardware threads
+    uint32_t threadCount = 0;
+
+    // enable stream mode (--stream)
+    // the packets are not stored, the position of every packet is computed by a keyed permutation
+    bool streamMode = false;
+
+    // print the packets in [sliceBegin, sliceBegin + sliceCount) only (--slice), implies stream mode
+    // 0 means all the packets after sliceBegin
+    uint32_t sliceBegin = 0;
+    uint32_t sliceCount = 0;
+
+    // the batch file path (--batch)
+    // every line of the batch file is a job with its own -n/-d, -rd, -fd, --temporal, --churn, --rate, --miss-ratio, --overlap-depth, -s and -o
+    std::string batchFilePath;
+
     // whether use pre-defined protocol is set in RuleTypeUd (-p)
 
 public:
     TraceConfiguration() = default;
     TraceConfiguration(int argc, char* argv[]); // read the parameters specified by the user
+    // the configuration of the jobIndex-th job in batch mode, the parameters of the job override the base configuration
+    // the output file path is <base output file path>_<jobIndex> if not specified
+    TraceConfiguration(const TraceConfiguration& base, const std::vector<std::string>& parameters, uint32_t jobIndex);
 
     // print the configuration
     void print(std::ostream& os) const;
 
 private:
+    // read a parameter which can be specified by a job (-n, -d, -o, -rd, -fd, --temporal, --churn, --rate, --miss-ratio, --overlap-depth, -s)
+    // return false if the parameter is not a job parameter
+    bool readJobParameter(int argc, char* argv[], int& i);
+
+    // exit with an error if argv[i] is not followed by count values
+    // argv of a batch job is not null-terminated, so every value is checked against argc
+    static void checkValueCount(int argc, char* argv[], int i, int count);
+
+    // read a distribution after argv[i], i is moved to the last parameter of the distribution
+    // "alpha beta": Pareto(alpha, beta)
+    // "zipf:s" or "zipf:s:N": Zipf(s, N)
+    static std::unique_ptr<CountDistribution> readDistribution(int argc, char* argv[], int& i);
+
+    // read a rate model "type:rate[:parameters]" after argv[i], i is moved to it
+    static RateModel readRateModel(int argc, char* argv[], int& i);
+
+    void applyModes();
     void applyDefaultConfiguration();
 
 public:
@@ -85,21 +164,108 @@ public:
         return outputStyle;
     }
 
+    bool enableBinaryOutput() const {
+        return binaryOutput;
+    }
+
+    bool enablePcapOutput() const {
+        return pcapOutput;
+    }
+
+    const CountDistribution& getRuleDistribution() const {
+        return *ruleDistribution;
+    }
+
+    const CountDistribution& getFlowDistribution() const {
+        return *flowDistribution;
+    }
+
+    // nullptr if the temporal locality is not specified
+    const CountDistribution* getTemporalDistribution() const {
+        return temporalDistribution.get();
+    }
+
+    // nullptr if the flow churn is not specified
+    const CountDistribution* getLifetimeDistribution() const {
+        return lifetimeDistribution.get();
+    }
+
+    const RateModel& getRateModel() const {
+        return rateModel;
+    }
+
+    double getMissRatio() const {
+        return missRatio;
+    }
+
+    // the number of the packets which miss the rules, out of traceCount packets
+    uint32_t getMissCount(uint32_t traceCount) const {
+        return static_cast<uint32_t>(std::llround(traceCount * missRatio));
+    }
+
+    uint32_t getOverlapDepth() const {
+        return overlapDepth;
+    }
+
+    // whether the overlap index of the rule pool is needed besides rejection mode
+    bool needRulePool() const {
+        return missRatio > 0.0 || overlapDepth > 1;
+    }
+
+    uint32_t getRandomSeed() const {
+        return randomSeed;
+    }
+
     bool enableFastMode() const {
         return fastMode;
     }
+
+    bool enableRejectionMode() const {
+        return rejectionMode;
+    }
+
+    bool enableCache() const {
+        return cacheEnabled;
+    }
+
+    std::string getCacheFilePath() const {
+        return inputFilePath + ".isocache";
+    }
+
+    uint32_t getThreadCount() const {
+        return threadCount;
+    }
+
+    bool enableStreamMode() const {
+        return streamMode;
+    }
+
+    uint32_t getSliceBegin() const {
+        return std::min(sliceBegin, traceCount);
+    }
+
+    uint32_t getSliceEnd() const {
+        if (sliceCount == 0 || sliceCount > traceCount - getSliceBegin()) {
+            return traceCount;
+        }
+        return getSliceBegin() + sliceCount;
+    }
+
+    bool enableBatchMode() const {
+        return !batchFilePath.empty();
+    }
+
+    const std::string& getBatchFilePath() const {
+        return batchFilePath;
+    }
 };
 
 TraceConfiguration::TraceConfiguration(int argc, char* argv[]) {
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "-n") == 0) {
-            traceCount = std::stoul(argv[++i]);
-        } else if (strcmp(argv[i], "-d") == 0) {
-            traceDensity = std::stod(argv[++i]);
+        if (readJobParameter(argc, argv, i)) {
+            continue;
         } else if (strcmp(argv[i], "-i") == 0) {
             inputFilePath = argv[++i];
-        } else if (strcmp(argv[i], "-o") == 0) {
-            outputFilePath = argv[++i];
         } else if (strcmp(argv[i], "-f") == 0) {
             RuleTypeUD::getInstance().setFieldCount(std::stoul(argv[++i]));
         } else if (strcmp(argv[i], "-fw") == 0) {
@@ -110,20 +276,32 @@ TraceConfiguration::TraceConfiguration(int argc, char* argv[]) {
             for (uint8_t j = 0; j < RuleTypeUD::getInstance().getFieldCount(); j++) {
                 RuleTypeUD::getInstance().setMatchType(j, getEnumValue<MatchType>(argv[++i]));
             }
-        } else if (strcmp(argv[i], "-rd") == 0) {
-            ParetoDistribution::ruleDistribution.setAlpha(std::stod(argv[++i]));
-            ParetoDistribution::ruleDistribution.setBeta(std::stod(argv[++i]));
-        } else if (strcmp(argv[i], "-fd") == 0) {
-            ParetoDistribution::flowDistribution.setAlpha(std::stod(argv[++i]));
-            ParetoDistribution::flowDistribution.setBeta(std::stod(argv[++i]));
-        } else if (strcmp(argv[i], "-s") == 0) {
-            randomSeed = std::stoul(argv[++i]);
         } else if (strcmp(argv[i], "--flowbench") == 0) {
             outputStyle = RuleOutputStyle::FlowBench;
         } else if (strcmp(argv[i], "--classbench") == 0) {
             outputStyle = RuleOutputStyle::ClassBench;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            binaryOutput = true;
+            pcapOutput = false;
+        } else if (strcmp(argv[i], "--pcap") == 0) {
+            pcapOutput = true;
+            binaryOutput = false;
         } else if (strcmp(argv[i], "--fast") == 0) {
-            fastMode = true;
+            fastModeSpecified = true;
+        } else if (strcmp(argv[i], "--rejection") == 0) {
+            rejectionModeSpecified = true;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            cacheEnabled = true;
+        } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) {
+            threadCount = std::stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            streamMode = true;
+        } else if (strcmp(argv[i], "--slice") == 0) {
+            streamMode = true;
+            sliceBegin = std::stoul(argv[++i]);
+            sliceCount = std::stoul(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batchFilePath = argv[++i];
         } else if (strcmp(argv[i], "-p") == 0) {
             RuleTypeUD::getInstance().setProtocol(getEnumValue<Protocol>(argv[++i]));
         } else {
@@ -134,12 +312,149 @@ TraceConfiguration::TraceConfiguration(int argc, char* argv[]) {
     applyDefaultConfiguration();
 }
 
+TraceConfiguration::TraceConfiguration(const TraceConfiguration& base, const std::vector<std::string>& parameters, uint32_t jobIndex)
+    : ruleCount(base.ruleCount), inputFilePath(base.inputFilePath), outputFilePath(base.outputFilePath + "_" + std::to_string(jobIndex)),
+      ruleDistribution(base.ruleDistribution->clone()), flowDistribution(base.flowDistribution->clone()),
+      temporalDistribution(base.temporalDistribution != nullptr ? base.temporalDistribution->clone() : nullptr),
+      lifetimeDistribution(base.lifetimeDistribution != nullptr ? base.lifetimeDistribution->clone() : nullptr),
+      missRatio(base.missRatio), overlapDepth(base.overlapDepth), rateModel(base.rateModel), randomSeed(base.randomSeed), outputStyle(base.outputStyle),
+      binaryOutput(base.binaryOutput), pcapOutput(base.pcapOutput),
+      fastModeSpecified(base.fastModeSpecified), rejectionModeSpecified(base.rejectionModeSpecified),
+      threadCount(1), streamMode(base.streamMode), sliceBegin(base.sliceBegin), sliceCount(base.sliceCount) {
+    std::vector<char*> argv;
+    for (const auto& parameter : parameters) {
+        argv.push_back(const_cast<char*>(parameter.c_str()));
+    }
+    int argc = static_cast<int>(argv.size());
+    for (int i = 0; i < argc; i++) {
+        if (!readJobParameter(argc, argv.data(), i)) {
+            std::cerr << "Unknown parameter in batch job: " << argv[i] << std::endl;
+            exit(1);
+        }
+    }
+    if (traceCount == 0 && traceDensity == 0.0) {
+        traceCount = base.traceCount;
+        traceDensity = base.traceDensity;
+    } else if (traceCount == 0) {
+        traceCount = static_cast<uint32_t>(ruleCount * traceDensity);
+    }
+    applyModes();
+}
+
+bool TraceConfiguration::readJobParameter(int argc, char* argv[], int& i) {
+    auto value = [&]() {
+        checkValueCount(argc, argv, i, 1);
+        return argv[++i];
+    };
+    if (strcmp(argv[i], "-n") == 0) {
+        traceCount = std::stoul(value());
+    } else if (strcmp(argv[i], "-d") == 0) {
+        traceDensity = std::stod(value());
+    } else if (strcmp(argv[i], "-o") == 0) {
+        outputFilePath = value();
+    } else if (strcmp(argv[i], "-rd") == 0) {
+        ruleDistribution = readDistribution(argc, argv, i);
+    } else if (strcmp(argv[i], "-fd") == 0) {
+        flowDistribution = readDistribution(argc, argv, i);
+    } else if (strcmp(argv[i], "--temporal") == 0) {
+        temporalDistribution = readDistribution(argc, argv, i);
+    } else if (strcmp(argv[i], "--churn") == 0) {
+        lifetimeDistribution = readDistribution(argc, argv, i);
+    } else if (strcmp(argv[i], "--miss-ratio") == 0) {
+        missRatio = std::stod(value());
+        if (missRatio < 0.0 || missRatio >= 1.0) {
+            std::cerr << "The miss ratio should be in [0, 1)" << std::endl;
+            exit(1);
+        }
+    } else if (strcmp(argv[i], "--overlap-depth") == 0) {
+        overlapDepth = std::stoul(value());
+    } else if (strcmp(argv[i], "--rate") == 0) {
+        rateModel = readRateModel(argc, argv, i);
+    } else if (strcmp(argv[i], "-s") == 0) {
+        randomSeed = std::stoul(value());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void TraceConfiguration::checkValueCount(int argc, char* argv[], int i, int count) {
+    if (i + count >= argc) {
+        std::cerr << "Missing value for " << argv[i] << std::endl;
+        exit(1);
+    }
+}
+
+std::unique_ptr<CountDistribution> TraceConfiguration::readDistribution(int argc, char* argv[], int& i) {
+    checkValueCount(argc, argv, i, 1);
+    if (strncmp(argv[i + 1], "zipf:", 5) == 0) {
+        std::string parameter = argv[++i] + 5;
+        auto colon = parameter.find(':');
+        double s = std::stod(parameter.substr(0, colon));
+        uint32_t n = ZipfDistribution::DEFAULT_MAX_COUNT;
+        if (colon != std::string::npos) {
+            n = std::stoul(parameter.substr(colon + 1));
+        }
+        if (s <= 0.0 || n == 0) {
+            std::cerr << "Invalid Zipf distribution: " << argv[i] << std::endl;
+            exit(1);
+        }
+        return std::make_unique<ZipfDistribution>(s, n);
+    }
+    checkValueCount(argc, argv, i, 2);
+    double alpha = std::stod(argv[++i]);
+    double beta = std::stod(argv[++i]);
+    return std::make_unique<ParetoDistribution>(alpha, beta);
+}
+
+RateModel TraceConfiguration::readRateModel(int argc, char* argv[], int& i) {
+    checkValueCount(argc, argv, i, 1);
+    std::string parameter = argv[++i];
+    std::vector<double> values;
+    auto colon = parameter.find(':');
+    auto type = getEnumValue<RateModelType>(parameter.substr(0, colon).c_str());
+    while (colon != std::string::npos) {
+        auto next = parameter.find(':', colon + 1);
+        values.push_back(std::stod(parameter.substr(colon + 1, next - colon - 1)));
+        colon = next;
+    }
+    uint32_t valueCount = type == RateModelType::OnOff ? 3 : (type == RateModelType::Train ? 2 : 1);
+    if (type == RateModelType::Unknown || values.size() != valueCount ||
+        std::any_of(values.begin(), values.end(), [](double value) { return value < 0.0; }) || values[0] <= 0.0 ||
+        (type == RateModelType::OnOff && values[1] <= 0.0)) {
+        std::cerr << "Invalid rate model: " << argv[i] << std::endl;
+        exit(1);
+    }
+    values.resize(3, 0.0);
+    if (type == RateModelType::Train) {
+        return RateModel(type, values[0], 0.0, values[1]);
+    }
+    return RateModel(type, values[0], values[1], values[2]);
+}
+
+void TraceConfiguration::applyModes() {
+    fastMode = fastModeSpecified || ruleDistribution->isDisabled();
+    rejectionMode = rejectionModeSpecified && !fastMode;
+    if (temporalDistribution != nullptr && streamMode) {
+        std::cerr << "--temporal orders the stored packets, it cannot be used with --stream or --slice" << std::endl;
+        exit(1);
+    }
+    if (temporalDistribution != nullptr && lifetimeDistribution != nullptr) {
+        std::cerr << "--temporal and --churn cannot be used together" << std::endl;
+        exit(1);
+    }
+}
+
 void TraceConfiguration::applyDefaultConfiguration() {
     if (traceCount == 0 && traceDensity == 0.0) {
         traceCount = 1000;
     }
-    if (ParetoDistribution::ruleDistribution.getAlpha() == 0.0) {
-        fastMode = true;
+    applyModes();
+    if (fastModeSpecified || rejectionModeSpecified || (!enableBatchMode() && fastMode)) { // the isolate rule set is not built
+        cacheEnabled = false;
+    }
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
     }
     if (inputFilePath.empty()) {
         inputFilePath = "input.txt";
@@ -150,6 +465,10 @@ void TraceConfiguration::applyDefaultConfiguration() {
     if (RuleTypeUD::getInstance().getFieldCount() == 0) {
         RuleTypeUD::getInstance().setProtocol(Protocol::IPv4);
     }
+    if (pcapOutput && RuleTypeUD::getInstance().getProtocol() == Protocol::Unknown) {
+        std::cerr << "The pcap output only supports the pre-defined protocols (-p)" << std::endl;
+        exit(1);
+    }
     Random::setInstance(randomSeed);
     RuleFormat::outputFormat.setStyle(outputStyle);
 }
@@ -170,12 +489,47 @@ void TraceConfiguration::print(std::ostream& os) const {
         os << getEnumName(RuleTypeUD::getInstance().getMatchType(i)) << " ";
     }
     os << std::endl;
-    os << "Rule Distribution: Pareto(" << ParetoDistribution::ruleDistribution.getAlpha() << ", "
-       << ParetoDistribution::ruleDistribution.getBeta() << ")" << std::endl;
-    os << "Flow Distribution: Pareto(" << ParetoDistribution::flowDistribution.getAlpha() << ", "
-       << ParetoDistribution::flowDistribution.getBeta() << ")" << std::endl;
+    os << "Rule Distribution: ";
+    ruleDistribution->print(os);
+    os << std::endl;
+    os << "Flow Distribution: ";
+    flowDistribution->print(os);
+    os << std::endl;
+    if (temporalDistribution != nullptr) {
+        os << "Temporal Distribution: ";
+        temporalDistribution->print(os);
+        os << std::endl;
+    }
+    if (lifetimeDistribution != nullptr) {
+        os << "Lifetime Distribution: ";
+        lifetimeDistribution->print(os);
+        os << std::endl;
+    }
+    if (missRatio > 0.0) {
+        os << "Miss Ratio: " << missRatio << std::endl;
+    }
+    if (overlapDepth > 1) {
+        os << "Overlap Depth: " << overlapDepth << std::endl;
+    }
+    if (binaryOutput || pcapOutput) {
+        os << "Rate Model: ";
+        rateModel.print(os);
+        os << std::endl;
+    }
     os << "Random Seed: " << randomSeed << std::endl;
-    os << "Output Style: " << getEnumName(outputStyle) << std::endl;
+    os << "Output Style: " << (pcapOutput ? "Pcap" : (binaryOutput ? "Binary" : getEnumName(outputStyle))) << std::endl;
+    os << "Trace Mode: " << (fastMode ? "Fast" : (rejectionMode ? "Rejection" : "Isolation")) << std::endl;
+    os << "Thread Count: " << threadCount << std::endl;
+    os << "Isolation Cache: " << (cacheEnabled ? getCacheFilePath() : "Disabled") << std::endl;
+    if (streamMode) {
+        os << "Stream Mode: Enabled" << std::endl;
+    }
+    if (sliceBegin != 0 || sliceCount != 0) {
+        os << "Slice: [" << getSliceBegin() << ", " << getSliceEnd() << ")" << std::endl;
+    }
+    if (enableBatchMode()) {
+        os << "Batch File Path: " << batchFilePath << std::endl;
+    }
 }
 
 }
\ No newline at end of file
@@ -17,6 +17,9 @@ constexpr uint8_t QD_FIELD_CNT  = 3;
 constexpr const char* NORMAL_PROFILE_PATH = "normal_profile.txt";
 constexpr const char* DENSE_PROFILE_PATH = "dense_profile.txt";
 
+// the result of a selection when there is no candidate (all weights are zero)
+constexpr uint32_t NO_CANDIDATE = UINT32_MAX;
+
 // default configuration
 constexpr uint32_t DEFAULT_RULE_CNT = 64; //4096;
 
@@ -0,0 +1,65 @@
+#pragma once
+
+// the distribution of the copy counts, which controls the spatial locality of the traces
+// a copy count is the number of traces of a flow (or a rule), and it is at least 1
+// the counts are drawn in blocks, so a distribution can transform a block of uniform variates at once
+// the random variates come from the random engine of the current thread (see Random), or from a given source
+// we provide two distributions
+// 1. Pareto(alpha, beta), see pareto_distribution.hpp
+// 2. Zipf(s, N), see zipf_distribution.hpp
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "random.hpp"
+
+namespace flowbench {
+
+// a source of uniform 32-bit variates
+class UniformSource {
+public:
+    virtual ~UniformSource() = default;
+
+    virtual uint32_t nextUInt32() = 0;
+
+    // the same variate as Random::nextDouble
+    double nextDouble(double min, double max) {
+        return min + (max - min) * nextUInt32() / 4294967295.0;
+    }
+};
+
+// the random engine of the current thread as a source
+class ThreadUniformSource : public UniformSource {
+public:
+    uint32_t nextUInt32() override {
+        return Random::getInstance().nextUInt32();
+    }
+};
+
+class CountDistribution {
+public:
+    virtual ~CountDistribution() = default;
+
+    // fill the block with copy counts
+    void fill(std::vector<uint32_t>& block) const {
+        ThreadUniformSource source;
+        fill(block, source);
+    }
+
+    // fill the block with copy counts, drawn from the source
+    // (for a component with its own random engine, see churn_scheduler.hpp)
+    virtual void fill(std::vector<uint32_t>& block, UniformSource& source) const = 0;
+
+    // whether the distribution is not specified (the locality is disabled)
+    virtual bool isDisabled() const {
+        return false;
+    }
+
+    virtual void print(std::ostream& os) const = 0;
+
+    virtual std::unique_ptr<CountDistribution> clone() const = 0;
+
+};
+
+}
\ No newline at end of file
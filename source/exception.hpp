@@ -6,24 +6,17 @@
 
 namespace flowbench {
 
-class BitWidthError : public std::exception {
-public:
-    const char* what() const noexcept override {
-        return "Bit width is not sufficient error";
-    }
-};
-
-class NoCandidateError : public std::exception {
+class NoRuleError : public std::exception {
 public:
     const char* what() const noexcept override {
-        return "No candidate can be selected error";
+        return "No rule can be selected error";
     }
 };
 
-class NoRuleError : public std::exception {
+class NoMissError : public std::exception {
 public:
     const char* what() const noexcept override {
-        return "No rule can be selected error";
+        return "No header can miss the rules error";
     }
 };
 
@@ -0,0 +1,72 @@
+#pragma once
+
+// a keyed pseudo-random permutation of [0, n) (for stream mode of the trace)
+// the shuffle of the trace needs all the packets in memory, while this permutation maps an index to its position directly
+// 1. the index is split into two halves of b bits, 2^(2b) >= n, and goes through ROUND_COUNT Feistel rounds
+//    L, R -> R, L ^ F(R, key_r), which is a permutation of [0, 2^(2b)) for any round function F
+// 2. if the result is not less than n, it goes through the rounds again (cycle walking)
+//    the result stays in the same cycle of the permutation, so it is a permutation of [0, n)
+//    2^(2b) < 4n, so it takes less than 4 walks on average
+// the permutation only depends on n and the key, so different processes with the same seed get the same one
+
+#include <cstdint>
+
+namespace flowbench {
+
+class FeistelPermutation {
+private:
+    constexpr static uint32_t ROUND_COUNT = 4;
+
+    uint64_t size;
+    uint8_t halfWidth = 1;
+    uint64_t halfMask = 1;
+    uint64_t keys[ROUND_COUNT];
+
+    // the finalizer of SplitMix64, a cheap mixing function with good avalanche
+    static uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t encrypt(uint64_t index) const {
+        uint64_t left = index >> halfWidth;
+        uint64_t right = index & halfMask;
+        for (uint32_t r = 0; r < ROUND_COUNT; r++) {
+            uint64_t next = left ^ (mix(right ^ keys[r]) & halfMask);
+            left = right;
+            right = next;
+        }
+        return left << halfWidth | right;
+    }
+
+public:
+    FeistelPermutation(uint64_t size, uint64_t key);
+
+    uint64_t getSize() const {
+        return size;
+    }
+
+    // the image of index, index < size
+    uint64_t operator()(uint64_t index) const {
+        do {
+            index = encrypt(index);
+        } while (index >= size);
+        return index;
+    }
+};
+
+constexpr uint32_t FeistelPermutation::ROUND_COUNT;
+
+FeistelPermutation::FeistelPermutation(uint64_t size, uint64_t key) : size(size) {
+    while (halfWidth < 32 && (1ull << (2 * halfWidth)) < size) {
+        halfWidth++;
+    }
+    halfMask = (1ull << halfWidth) - 1;
+    for (uint32_t r = 0; r < ROUND_COUNT; r++) {
+        key = mix(key + 0x9e3779b97f4a7c15ull);
+        keys[r] = key;
+    }
+}
+
+}
\ No newline at end of file
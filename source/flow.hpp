@@ -1,12 +1,16 @@
 #pragma once
 
 // a flow with User-defined fields
+// the rule index of a miss flow (see miss_generator.hpp) is MISS_RULE_INDEX if no rule matches it
 
 #include "rule.hpp"
 
 namespace flowbench {
 
 class Flow {
+public:
+    constexpr static uint32_t MISS_RULE_INDEX = UINT32_MAX;
+
 private:
     std::vector<std::unique_ptr<Integer>> fields;
     uint32_t ruleIndex = 0;
@@ -30,11 +34,36 @@ public:
         return *fields[index];
     }
 
+    void setField(uint8_t index, std::unique_ptr<Integer> field) {
+        fields[index] = std::move(field);
+    }
+
     uint32_t getRuleIndex() const {
         return ruleIndex;
     }
+
+    void setRuleIndex(uint32_t ruleIndex) {
+        this->ruleIndex = ruleIndex;
+    }
+
+    // the key of a value (or a bound) truncated to the field width
+    // the bits beyond the width are not printed, so they are ignored when matching
+    static FieldKey truncate(FieldKey key, uint8_t width) {
+        if (width < 64) {
+            key.first &= ~(UINT64_MAX >> width);
+            key.second = 0;
+        } else if (width < 128) {
+            key.second &= ~(UINT64_MAX >> (width - 64));
+        }
+        return key;
+    }
+
+    // whether the flow matches the rule (on the printed bits)
+    bool match(const UDRule& rule) const;
 };
 
+constexpr uint32_t Flow::MISS_RULE_INDEX;
+
 // generate an exact match flow from a rule
 Flow::Flow(const UDRule& rule, uint32_t ruleIndex) {
     for (uint8_t i = 0; i < rule.getFieldCount(); i++) {
@@ -43,4 +72,15 @@ Flow::Flow(const UDRule& rule, uint32_t ruleIndex) {
     this->ruleIndex = ruleIndex;
 }
 
+bool Flow::match(const UDRule& rule) const {
+    for (uint8_t i = 0; i < rule.getFieldCount(); i++) {
+        uint8_t width = RuleTypeUD::getInstance().getFieldWidth(i);
+        FieldKey key = truncate(FieldKey(fields[i]->getHighBits(), fields[i]->getLowBits()), width);
+        if (key < truncate(rule.getField(i).getMinKey(), width) || key > truncate(rule.getField(i).getMaxKey(), width)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+// the result of the trace allocation
+// the traces are allocated to some groups (rules), and the traces of a group are allocated to some flows
+// the trace counts of all the flows are stored in one array (CSR), grouped by the groups
+// a group is an offset and a size in the array, so there is no heap allocation per group
+// e.g. groups [5, 3], [7], [1, 1, 1]: counts = 5 3 7 1 1 1, offsets = 0 2 3, sizes = 2 1 3
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace flowbench {
+
+class FlowAllocation {
+private:
+    std::vector<uint32_t> counts;  // the trace count of every flow
+    std::vector<uint32_t> offsets; // the first flow of every group
+    std::vector<uint32_t> sizes;   // the flow count of every group
+
+public:
+    FlowAllocation() = default;
+
+    void clear() {
+        counts.clear();
+        offsets.clear();
+        sizes.clear();
+    }
+
+    // append a group with the given flows
+    void push_back(const std::vector<uint32_t>& flows) {
+        offsets.push_back(counts.size());
+        sizes.push_back(flows.size());
+        counts.insert(counts.end(), flows.begin(), flows.end());
+    }
+
+    // build the groups from the group index of every flow
+    // groupCount: the number of groups, every group should have at least one flow
+    void assign(const std::vector<uint32_t>& flows, const std::vector<uint32_t>& groupIndexes, uint32_t groupCount);
+
+    // sort the groups by flow count (descending)
+    // the order of the groups is the same as sorting a vector of groups with std::sort
+    void sortBySize();
+
+    // merge all the flows of a group into one flow
+    void merge(uint32_t group) {
+        uint32_t begin = offsets[group];
+        counts[begin] = std::accumulate(counts.begin() + begin, counts.begin() + begin + sizes[group], 0u);
+        sizes[group] = 1;
+    }
+
+    // the number of groups
+    uint32_t size() const {
+        return offsets.size();
+    }
+
+    uint32_t getFlowCount(uint32_t group) const {
+        return sizes[group];
+    }
+
+    uint32_t getTraceCount(uint32_t group, uint32_t flow) const {
+        return counts[offsets[group] + flow];
+    }
+};
+
+void FlowAllocation::assign(const std::vector<uint32_t>& flows, const std::vector<uint32_t>& groupIndexes, uint32_t groupCount) {
+    sizes.assign(groupCount, 0);
+    for (auto group : groupIndexes) {
+        sizes[group]++;
+    }
+    offsets.resize(groupCount);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < groupCount; i++) {
+        offsets[i] = offset;
+        offset += sizes[i];
+    }
+    counts.resize(flows.size());
+    std::vector<uint32_t> next = offsets;
+    for (uint32_t i = 0; i < flows.size(); i++) {
+        counts[next[groupIndexes[i]]++] = flows[i];
+    }
+}
+
+void FlowAllocation::sortBySize() {
+    std::vector<uint32_t> order(size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return sizes[a] > sizes[b];
+    });
+    std::vector<uint32_t> sortedOffsets(size());
+    std::vector<uint32_t> sortedSizes(size());
+    for (uint32_t i = 0; i < size(); i++) {
+        sortedOffsets[i] = offsets[order[i]];
+        sortedSizes[i] = sizes[order[i]];
+    }
+    offsets.swap(sortedOffsets);
+    sizes.swap(sortedSizes);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+// enumerate k different flows of a rule (for Flow Mapping)
+// instead of splitting the rule into k sub-rules recursively (k - 1 splits and 2(k - 1) clones)
+// we make the decisions of all the splits once
+// 1. d = ceil(log2(k)) bits are needed to tell the flows apart
+//    every bit is assigned to a field with available bits, randomly selected by the field weights
+//    (the same as the field selected by RuleSplitter)
+//    the field weights are read from the configuration by the caller, as the enumerators are built on the worker threads
+// 2. the j-th flow gets the d-bit pattern (j * a + b) mod 2^d, where a is a random odd number and b is random
+//    it is a permutation of the patterns, so the patterns of different flows are different
+//    and the flows are scattered over the rule instead of being packed into the first k parts
+// 3. every field takes its bits from the pattern and hits the selected part of the field (see MatchField::hit)
+// so the cost of a flow is a few integer operations per field
+
+#include "configuration.hpp"
+#include "exception.hpp"
+#include "flow.hpp"
+#include "random_selector.hpp"
+
+namespace flowbench {
+
+class FlowEnumerator {
+private:
+    const UDRule& rule;
+
+    // the bits of the pattern taken by every field: [offsets[i], offsets[i] + lengths[i])
+    std::vector<uint8_t> lengths;
+    std::vector<uint8_t> offsets;
+
+    uint64_t multiplier = 1;
+    uint64_t increment = 0;
+    uint64_t mask = 0;
+
+public:
+    // fieldWeights: the weight of every field (see Configuration::getFieldWeight)
+    // throw NoRuleError if the rule cannot hold flowCount flows
+    FlowEnumerator(const UDRule& rule, uint32_t flowCount, const std::vector<double>& fieldWeights);
+
+    const UDRule& getRule() const {
+        return rule;
+    }
+
+    // the flowIndex-th flow of the rule
+    std::unique_ptr<Flow> getFlow(uint32_t flowIndex, uint32_t ruleIndex) const;
+};
+
+FlowEnumerator::FlowEnumerator(const UDRule& rule, uint32_t flowCount, const std::vector<double>& fieldWeights)
+    : rule(rule) {
+    uint8_t fieldCount = rule.getFieldCount();
+    lengths.assign(fieldCount, 0);
+    offsets.assign(fieldCount, 0);
+    uint8_t bits = 0;
+    while (bits < 32 && (1ull << bits) < flowCount) {
+        bits++;
+    }
+    std::vector<uint8_t> availableWidths(fieldCount);
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        availableWidths[i] = rule.getAvailableWidth(i);
+    }
+    std::vector<double> weights(fieldCount);
+    for (uint8_t b = 0; b < bits; b++) {
+        for (uint8_t i = 0; i < fieldCount; i++) {
+            weights[i] = lengths[i] < availableWidths[i] ? fieldWeights[i] : 0;
+        }
+        uint32_t fieldIndex = RandomSelector::getInstance().select(weights);
+        if (fieldIndex == NO_CANDIDATE) {
+            throw NoRuleError();
+        }
+        lengths[fieldIndex]++;
+    }
+    for (uint8_t i = 1; i < fieldCount; i++) {
+        offsets[i] = offsets[i - 1] + lengths[i - 1];
+    }
+    mask = (1ull << bits) - 1;
+    multiplier = (Random::getInstance().nextUInt32() | 1) & mask;
+    increment = Random::getInstance().nextUInt32() & mask;
+}
+
+std::unique_ptr<Flow> FlowEnumerator::getFlow(uint32_t flowIndex, uint32_t ruleIndex) const {
+    uint64_t pattern = (flowIndex * multiplier + increment) & mask;
+    auto flow = std::make_unique<Flow>(rule.getFieldCount());
+    for (uint8_t i = 0; i < rule.getFieldCount(); i++) {
+        uint32_t fieldPattern = (pattern >> offsets[i]) & ((1ull << lengths[i]) - 1);
+        uint8_t width = RuleTypeUD::getInstance().getFieldWidth(i);
+        flow->setField(i, rule.getField(i).hit(fieldPattern, lengths[i], width));
+    }
+    flow->setRuleIndex(ruleIndex);
+    return flow;
+}
+
+}
\ No newline at end of file
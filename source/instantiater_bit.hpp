@@ -20,18 +20,20 @@ private:
 
 public:
     BitInstantiater() = default;
-    void operator()(CandidateRuleSet& ruleSet);
-};
 
-void BitInstantiater::operator()(CandidateRuleSet& ruleSet) {
-    for (uint8_t i = 0; i < QD_FIELD_CNT; i++) {
-        masks[i] = Random::getInstance().nextUInt32();
+    // generate the masks of the current subproblem
+    void generateMasks() {
+        for (uint8_t i = 0; i < QD_FIELD_CNT; i++) {
+            masks[i] = Random::getInstance().nextUInt32();
+        }
     }
-    for (uint8_t i = 0; i < ruleSet.size(); i++) {
-        for (uint8_t j = 0; j < QD_FIELD_CNT; j++) {
-            ruleSet.getRule(i).getFieldAs<LpmField<Int32>>(j) ^= masks[j];
+
+    // apply the generated masks to the fields of a single rule
+    void apply(std::array<LpmField<Int32>, QD_FIELD_CNT>& fields) const {
+        for (uint8_t i = 0; i < QD_FIELD_CNT; i++) {
+            fields[i] ^= masks[i];
         }
     }
-}
+};
 
 }
\ No newline at end of file
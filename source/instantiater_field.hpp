@@ -21,12 +21,27 @@ class FieldInstantiater : public Singleton<FieldInstantiater> {
 public:
     FieldInstantiater();
 
-    // convert CRS to URS
-    // ruleSet: the candidate rule set (CRS) to be converted
+    // build the mapping (CRS -> URS) and the EM values
+    // widths: the required field widths of the candidate rules (CRS)
     // state: the problem state
     // profile: the selected QuadDag profile
-    // return: the converted user-defined rule set (URS)
-    std::unique_ptr<UDRuleSet> operator()(const CandidateRuleSet& ruleSet, const ProblemState& state, const QuadDagProfile& profile);
+    // return: false if some of the fields cannot be mapped (no available field is wide enough)
+    bool generateMapping(const std::array<uint8_t, QD_FIELD_CNT>& widths, const ProblemState& state, const QuadDagProfile& profile);
+
+    // convert a candidate rule (CRS) to a user-defined rule (URS) with the generated mapping
+    std::unique_ptr<UDRule> convert(const std::array<LpmField<Int32>, QD_FIELD_CNT>& fields) const;
+
+    // the required width of a user-defined field (URS)
+    // that is, the maximum prefix length of the candidate fields mapped to it
+    uint8_t getRequiredWidth(uint8_t fieldIndex) const {
+        uint8_t width = 0;
+        for (uint8_t i = 0; i < QD_FIELD_CNT; i++) {
+            if (mapping[i] == fieldIndex) {
+                width = std::max(width, requiredWidths[i]);
+            }
+        }
+        return width;
+    }
 
 private:
     // CRS index -> URS index
@@ -46,8 +61,9 @@ private:
     // whether the field has set up a mapping (URS)
     std::vector<bool> fieldMapped;
 
-    // instantiated EM fields (URS)
+    // instantiated EM fields (URS) and their random values
     std::vector<uint8_t> emFields;
+    std::vector<std::unique_ptr<MatchField>> emValues;
 
 };
 
@@ -56,17 +72,13 @@ FieldInstantiater::FieldInstantiater() {
     fieldMapped.resize(RuleTypeUD::getInstance().getFieldCount());
 }
 
-std::unique_ptr<UDRuleSet> FieldInstantiater::operator()(const CandidateRuleSet& ruleSet, const ProblemState& state, const QuadDagProfile& profile) {
+bool FieldInstantiater::generateMapping(const std::array<uint8_t, QD_FIELD_CNT>& widths, const ProblemState& state, const QuadDagProfile& profile) {
     std::fill(mapping.begin(), mapping.end(), 0);
-    std::fill(requiredWidths.begin(), requiredWidths.end(), 0);
+    requiredWidths = widths;
     std::copy(state.fieldWeights.begin(), state.fieldWeights.end(), fieldWeights.begin());
     std::fill(fieldMapped.begin(), fieldMapped.end(), false);
     emFields.clear();
-    for (uint8_t i = 0; i < ruleSet.size(); i++) {
-        for (uint8_t j = 0; j < profile.getActualFieldCount(); j++) {
-            requiredWidths[j] = std::max(requiredWidths[j], ruleSet.getRule(i).getFieldAs<LpmField<Int32>>(j).getPrefixLength());
-        }
-    }
+    emValues.clear();
     for (uint8_t i = 0; i < QD_FIELD_CNT; i++) {
         requiredWidthsOrder[i] = i;
     }
@@ -77,7 +89,10 @@ std::unique_ptr<UDRuleSet> FieldInstantiater::operator()(const CandidateRuleSet&
         uint8_t field = requiredWidthsOrder[i];
         uint8_t width = requiredWidths[field];
         while (true) {
-            uint8_t index = RandomSelector::getInstance().select(fieldWeights);
+            uint32_t index = RandomSelector::getInstance().select(fieldWeights);
+            if (index == NO_CANDIDATE) {
+                return false;
+            }
             fieldWeights[index] = 0;
             if (state.availableWidths[index] >= width) {
                 mapping[field] = index;
@@ -96,19 +111,23 @@ std::unique_ptr<UDRuleSet> FieldInstantiater::operator()(const CandidateRuleSet&
             mapping[i] = j++;
         }
     }
-    auto result = std::make_unique<UDRuleSet>();
-    for (uint8_t i = 0; i < ruleSet.size(); i++) {
-        auto rule = std::make_unique<UDRule>(ruleSet.getRule(i), mapping);
-        result->push_back(std::move(rule));
-    }
     for (uint8_t i = 0; i < emFields.size(); i++) {
         auto emField = RuleTypeUD::getInstance().createField(emFields[i])->clone();
         emField->randomize();
-        for (uint8_t j = 0; j < result->size(); j++) {
-            result->getRule(j).setField(emFields[i], emField->clone());
-        }
+        emValues.push_back(std::move(emField));
+    }
+    return true;
+}
+
+std::unique_ptr<UDRule> FieldInstantiater::convert(const std::array<LpmField<Int32>, QD_FIELD_CNT>& fields) const {
+    auto rule = std::make_unique<UDRule>();
+    for (uint8_t i = 0; i < QD_FIELD_CNT; i++) {
+        rule->getField(mapping[i]).convertFrom(fields[i]);
+    }
+    for (uint8_t i = 0; i < emFields.size(); i++) {
+        rule->setField(emFields[i], emValues[i]->clone());
     }
-    return result;
+    return rule;
 }
 
 
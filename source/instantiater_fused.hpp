@@ -0,0 +1,77 @@
+#pragma once
+
+// the fused version of the third to seventh steps of a recursive subproblem
+// if every step materializes a whole rule set (a CandidateRuleSet in step 3 and a UDRuleSet in step 5)
+// the sets are only consumed by the next step
+// however, none of the steps needs the other rules of the set once the per-node decisions are made
+// 1. the split suffixes of the virtual rules (step 3)
+// 2. the xor masks (step 4)
+// 3. the field mapping and the EM values (step 5)
+// 4. the cut points of the RM fields (step 7, if enabled Arbitrary Range)
+// therefore, we make these decisions first
+// and then instantiate the rules one by one, which are written to the final set or the next layer directly
+
+#include "rule_virtual_splitter.hpp"
+#include "instantiater_bit.hpp"
+#include "instantiater_field.hpp"
+#include "instantiater_rule.hpp"
+#include "random_perturbator.hpp"
+
+namespace flowbench {
+
+class FusedInstantiater : public Singleton<FusedInstantiater> {
+private:
+    const QuadDagProfile* profile = nullptr;
+
+    // the size of the (virtual) mixed rule set
+    uint32_t count = 0;
+
+public:
+    FusedInstantiater() = default;
+
+    // make the per-node decisions of step 3, 4, 5 and 7
+    // return false if the decisions cannot be made
+    bool prepare(const ProblemState& state, const QuadDagProfile& profile);
+
+    // instantiate the index-th rule of the mixed rule set
+    // parent: the parent rule of the current subproblem
+    std::unique_ptr<UDRule> instantiate(uint32_t index, const UDRule& parent) const;
+
+    uint32_t size() const {
+        return count;
+    }
+};
+
+bool FusedInstantiater::prepare(const ProblemState& state, const QuadDagProfile& profile) {
+    this->profile = &profile;
+    count = VirtualRuleSplitter::getInstance().plan(state, profile);
+    BitInstantiater::getInstance().generateMasks();
+    // xor does not change the prefix lengths, so the required widths can be computed before applying the masks
+    std::array<uint8_t, QD_FIELD_CNT> widths;
+    std::array<LpmField<Int32>, QD_FIELD_CNT> fields;
+    std::fill(widths.begin(), widths.end(), 0);
+    for (uint32_t i = 0; i < count; i++) {
+        if (!VirtualRuleSplitter::getInstance().getFields(i, profile, fields)) {
+            return false;
+        }
+        for (uint8_t j = 0; j < profile.getActualFieldCount(); j++) {
+            widths[j] = std::max(widths[j], fields[j].getPrefixLength());
+        }
+    }
+    if (!FieldInstantiater::getInstance().generateMapping(widths, state, profile)) {
+        return false;
+    }
+    RandomPerturbator::getInstance().prepare(*(state.parent));
+    return true;
+}
+
+std::unique_ptr<UDRule> FusedInstantiater::instantiate(uint32_t index, const UDRule& parent) const {
+    std::array<LpmField<Int32>, QD_FIELD_CNT> fields;
+    VirtualRuleSplitter::getInstance().getFields(index, *profile, fields);
+    BitInstantiater::getInstance().apply(fields);
+    auto rule = FieldInstantiater::getInstance().convert(fields);
+    RuleInstantiater::getInstance()(*rule, parent);
+    return rule;
+}
+
+}
\ No newline at end of file
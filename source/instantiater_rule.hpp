@@ -9,20 +9,25 @@
 // in this step, we will concatenate the parent virtual rule and the rules we have generated
 // e.g. parent = 1,* + child = 1,0 -> result = 11,0
 
-#include "rule_set.hpp"
+#include "random_perturbator.hpp"
 
 namespace flowbench {
 
 class RuleInstantiater : public Singleton<RuleInstantiater> {
 public:
     RuleInstantiater() = default;
-    void operator()(UDRuleSet& ruleSet, const UDRule& parent) const;
+
+    // if the cut points of a RM field are prepared (Arbitrary Range), they are used instead of the uniform ones
+    void operator()(UDRule& rule, const UDRule& parent) const;
 };
 
-void RuleInstantiater::operator()(UDRuleSet& ruleSet, const UDRule& parent) const {
+void RuleInstantiater::operator()(UDRule& rule, const UDRule& parent) const {
+    const auto& perturbator = RandomPerturbator::getInstance();
     for (uint8_t i = 0; i < RuleTypeUD::getInstance().getFieldCount(); i++) {
-        for (uint8_t j = 0; j < ruleSet.size(); j++) {
-            ruleSet.getRule(j).getField(i).setParent(parent.getField(i));
+        if (perturbator.isPrepared(i)) {
+            rule.getFieldAs<RmField<Int32>>(i).setParent(perturbator.getBoundaries(i), perturbator.getCellBits(i));
+        } else {
+            rule.getField(i).setParent(parent.getField(i));
         }
     }
 }
@@ -30,6 +30,24 @@ public:
         return low;
     }
 
+    uint64_t getHighBits() const override {
+        return high;
+    }
+
+    uint64_t getLowBits() const override {
+        return low;
+    }
+
+    void serialize(std::ostream& os) const override {
+        os.write(reinterpret_cast<const char*>(&high), sizeof(high));
+        os.write(reinterpret_cast<const char*>(&low), sizeof(low));
+    }
+
+    void deserialize(std::istream& is) override {
+        is.read(reinterpret_cast<char*>(&high), sizeof(high));
+        is.read(reinterpret_cast<char*>(&low), sizeof(low));
+    }
+
     // convert Int32 to Int128
     Int128(const Int32& other) : high(static_cast<uint64_t>(other.getValue()) << 32), low(0) {}
     Int128& operator=(const Int32& other) {
@@ -103,32 +121,23 @@ public:
     }
 
     Int128 operator<<(uint8_t shift) const {
-        if (shift == 0) {
-            return *this;
-        } else if (shift < 64) {
-            return Int128(high << shift, (high >> (64 - shift)) | (low << shift));
-        } else if (shift == 64) {
-            return Int128(low, 0);
-        } else {
-            return Int128(low << (shift - 64), 0);
-        }
+        Int128 result(*this);
+        result <<= shift;
+        return result;
     }
 
     Int128 operator>>(uint8_t shift) const {
-        if (shift == 0) {
-            return *this;
-        } else if (shift < 64) {
-            return Int128((high << (64 - shift)) | (low >> shift), low >> shift);
-        } else if (shift == 64) {
-            return Int128(0, high);
-        } else {
-            return Int128(0, high >> (shift - 64));
-        }
+        Int128 result(*this);
+        result >>= shift;
+        return result;
     }
 
     Int128& operator<<=(uint8_t shift) {
         if (shift == 0) {
             return *this;
+        } else if (shift >= 128) { // shifting by the width is undefined for built-in integers
+            high = 0;
+            low = 0;
         } else if (shift < 64) {
             high <<= shift;
             high |= low >> (64 - shift);
@@ -146,6 +155,9 @@ public:
     Int128& operator>>=(uint8_t shift) {
         if (shift == 0) {
             return *this;
+        } else if (shift >= 128) {
+            high = 0;
+            low = 0;
         } else if (shift < 64) {
             low >>= shift;
             low |= high << (64 - shift);
@@ -174,6 +186,9 @@ private:
         if (width <= 64) {
             trueValueLow = high >> (64 - width);
             trueValueHigh = 0;
+        } else if (width == 128) {
+            trueValueLow = low;
+            trueValueHigh = high;
         } else {
             trueValueLow = low >> (128 - width) | (high << (width - 64));
             trueValueHigh = high >> (128 - width);
@@ -84,20 +84,34 @@ public:
     }
 
     Int32 operator<<(uint8_t shift) const {
+        if (shift >= 32) { // shifting by the width is undefined for built-in integers
+            return Int32(0);
+        }
         return Int32(value << shift);
     }
 
     Int32 operator>>(uint8_t shift) const {
+        if (shift >= 32) { // shifting by the width is undefined for built-in integers
+            return Int32(0);
+        }
         return Int32(value >> shift);
     }
 
     Int32& operator<<=(uint8_t shift) {
-        value <<= shift;
+        if (shift >= 32) {
+            value = 0;
+        } else {
+            value <<= shift;
+        }
         return *this;
     }
 
     Int32& operator>>=(uint8_t shift) {
-        value >>= shift;
+        if (shift >= 32) {
+            value = 0;
+        } else {
+            value >>= shift;
+        }
         return *this;
     }
 
@@ -113,6 +127,22 @@ public:
         return value;
     }
 
+    uint64_t getHighBits() const override {
+        return static_cast<uint64_t>(value) << 32;
+    }
+
+    uint64_t getLowBits() const override {
+        return 0;
+    }
+
+    void serialize(std::ostream& os) const override {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void deserialize(std::istream& is) override {
+        is.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
     // only high bits are used
     std::string toBinaryString(uint8_t width) const override {
         if (width == 0) {
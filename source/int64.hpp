@@ -28,6 +28,22 @@ public:
         return value;
     }
 
+    uint64_t getHighBits() const override {
+        return value;
+    }
+
+    uint64_t getLowBits() const override {
+        return 0;
+    }
+
+    void serialize(std::ostream& os) const override {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void deserialize(std::istream& is) override {
+        is.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
     // convert Int32 to Int64
     Int64(const Int32& other) : value(static_cast<uint64_t>(other.getValue()) << 32) {}
     Int64& operator=(const Int32& other) {
@@ -95,20 +111,34 @@ public:
     }
 
     Int64 operator<<(uint8_t shift) const {
+        if (shift >= 64) { // shifting by the width is undefined for built-in integers
+            return Int64(0);
+        }
         return Int64(value << shift);
     }
 
     Int64 operator>>(uint8_t shift) const {
+        if (shift >= 64) { // shifting by the width is undefined for built-in integers
+            return Int64(0);
+        }
         return Int64(value >> shift);
     }
 
     Int64& operator<<=(uint8_t shift) {
-        value <<= shift;
+        if (shift >= 64) {
+            value = 0;
+        } else {
+            value <<= shift;
+        }
         return *this;
     }
 
     Int64& operator>>=(uint8_t shift) {
-        value >>= shift;
+        if (shift >= 64) {
+            value = 0;
+        } else {
+            value >>= shift;
+        }
         return *this;
     }
 
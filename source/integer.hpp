@@ -4,6 +4,7 @@
 // support 32-128 bit integer
 
 #include <cstdint>
+#include <istream>
 #include <ostream>
 #include <string>
 
@@ -25,6 +26,14 @@ public:
     virtual std::unique_ptr<Integer> clone() const = 0;
     virtual uint32_t getValue() const = 0;
 
+    // the value as a left-aligned 128-bit integer (for indexing)
+    virtual uint64_t getHighBits() const = 0;
+    virtual uint64_t getLowBits() const = 0;
+
+    // the raw value in binary (native byte order), for the isolation cache
+    virtual void serialize(std::ostream& os) const = 0;
+    virtual void deserialize(std::istream& is) = 0;
+
 public:
     // for output format, only high bits are used
     virtual std::string toBinaryString(uint8_t width) const = 0;  // LPM
@@ -0,0 +1,157 @@
+#pragma once
+
+// the cache of the isolate rule set (for trace generator, --cache)
+// building the isolate rule set is much slower than generating the traces
+// so we store the result in a binary file (the input file path + ".isocache") and reuse it
+// if the same rule set is used again (e.g. with different -n, -d, -fd or -s)
+// the cache is keyed by the FNV-1a hash of
+// 1. the content of the input file
+// 2. the protocol (field count, field widths and match types)
+// 3. the version of the cache format
+// file format (native byte order):
+//     magic "FBISO\0", version (4 bytes), key (8 bytes), rule count (4 bytes), isolate rule count (4 bytes),
+//     isolated (1 byte, 0 if the isolation failed and the rules are the original rules, see rule_isolator.hpp)
+//     for every isolate rule (sorted by available width): the index in the rule pool (4 bytes), the fields
+
+#include <fstream>
+#include <string>
+
+#include "rule_set_ud_index.hpp"
+
+namespace flowbench {
+
+class IsolationCache : public Singleton<IsolationCache> {
+private:
+    constexpr static char MAGIC[] = "FBISO";
+    constexpr static uint32_t VERSION = 2;
+
+    uint64_t key = 0;
+
+    // the number of rules in the rule pool
+    uint32_t ruleCount = 0;
+
+    // the loaded isolate rule set (nullptr if the cache is missed or the rule set is taken)
+    std::unique_ptr<UDRuleSetWithIndex> ruleSet;
+    bool hit = false;
+    bool isolated = false;
+
+    static void hash(uint64_t& key, const char* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            key ^= static_cast<uint8_t>(data[i]);
+            key *= 0x100000001b3ull;
+        }
+    }
+
+    template <class U>
+    static void write(std::ostream& os, const U& value) {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <class U>
+    static void read(std::istream& is, U& value) {
+        is.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+public:
+    IsolationCache() = default;
+
+    // compute the key of the input rule set, and load the cache file if the key matches
+    // return true if the cache is hit
+    bool load(const std::string& input, const std::string& path);
+
+    // store the isolate rule set to the cache file (load must be called first)
+    void save(const UDRuleSetWithIndex& ruleSet, uint32_t ruleCount, const std::string& path) const;
+
+    bool isHit() const {
+        return hit;
+    }
+
+    // whether the loaded rule set is isolated (the failed isolation is cached too, so it is not run again)
+    bool isIsolated() const {
+        return isolated;
+    }
+
+    uint32_t getRuleCount() const {
+        return ruleCount;
+    }
+
+    // take the loaded isolate rule set
+    std::unique_ptr<UDRuleSetWithIndex> take() {
+        return std::move(ruleSet);
+    }
+};
+
+constexpr char IsolationCache::MAGIC[];
+constexpr uint32_t IsolationCache::VERSION;
+
+bool IsolationCache::load(const std::string& input, const std::string& path) {
+    const auto& ruleType = RuleTypeUD::getInstance();
+    key = 0xcbf29ce484222325ull;
+    hash(key, input.data(), input.size());
+    uint8_t fieldCount = ruleType.getFieldCount();
+    hash(key, reinterpret_cast<const char*>(&fieldCount), sizeof(fieldCount));
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        uint8_t width = ruleType.getFieldWidth(i);
+        uint8_t matchType = static_cast<uint8_t>(ruleType.getMatchType(i));
+        hash(key, reinterpret_cast<const char*>(&width), sizeof(width));
+        hash(key, reinterpret_cast<const char*>(&matchType), sizeof(matchType));
+    }
+    hash(key, reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+
+    ruleSet = nullptr;
+    hit = false;
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    uint32_t version, size;
+    uint64_t fileKey;
+    uint8_t isolatedFlag;
+    is.read(magic, sizeof(magic));
+    read(is, version);
+    read(is, fileKey);
+    read(is, ruleCount);
+    read(is, size);
+    read(is, isolatedFlag);
+    if (!is || std::string(magic, sizeof(magic)) != std::string(MAGIC, sizeof(MAGIC)) || version != VERSION || fileKey != key) {
+        return false;
+    }
+    auto loaded = std::make_unique<UDRuleSetWithIndex>();
+    for (uint32_t i = 0; i < size && is; i++) {
+        uint32_t index;
+        read(is, index);
+        auto rule = std::make_unique<UDRule>();
+        for (uint8_t j = 0; j < fieldCount; j++) {
+            rule->getField(j).deserialize(is);
+        }
+        loaded->push_back(std::move(rule), index);
+    }
+    if (!is) { // truncated
+        return false;
+    }
+    isolated = isolatedFlag != 0;
+    loaded->setIsolated(isolated);
+    ruleSet = std::move(loaded);
+    hit = true;
+    return true;
+}
+
+void IsolationCache::save(const UDRuleSetWithIndex& ruleSet, uint32_t ruleCount, const std::string& path) const {
+    std::ofstream os(path, std::ios::binary);
+    os.write(MAGIC, sizeof(MAGIC));
+    write(os, VERSION);
+    write(os, key);
+    write(os, ruleCount);
+    write(os, static_cast<uint32_t>(ruleSet.size()));
+    write(os, static_cast<uint8_t>(ruleSet.isIsolated()));
+    for (uint32_t i = 0; i < ruleSet.size(); i++) {
+        write(os, ruleSet.getRuleIndex(i));
+        const auto& rule = ruleSet.getRule(i);
+        for (uint8_t j = 0; j < rule.getFieldCount(); j++) {
+            rule.getField(j).serialize(os);
+        }
+    }
+}
+
+}
\ No newline at end of file
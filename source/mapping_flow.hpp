@@ -7,71 +7,184 @@
 // in this step, we will build a mapping between the allocation result and the flows
 
 // for each rule in the rule set, we have known the number of flows it need to hold
-// 1. select the available fields
-// 2. randomly select an available field and split it into two fields
-// 3. repeat step 2 until the number of rules is satisfied
-// 4. for all those rules, randomly generate a flow (exact rule)
+// 1. plan which bits of the rule tell the flows apart (see flow_enumerator.hpp)
+// 2. enumerate the flows of the rule, every flow hits a different part of the rule
+//    in rejection mode, the flow is drawn by rejection sampling (see rejection_sampler.hpp)
+//    with --overlap-depth, the flow is drawn in an overlap region of the rule instead (see overlap_sampler.hpp)
+// 3. add the flow to the flow table of the trace, and its packets to the packet sequence (see trace.hpp)
+//    then add the miss flows after the flows of the rules (see miss_generator.hpp)
+// 4. shuffle the packets (in stream mode, draw the key of the permutation of the packets)
+//    or order them by temporal locality (see temporal_shuffler.hpp) or by flow churn (see churn_scheduler.hpp)
+//    then draw the seed of the timestamps (see rate_model.hpp)
+// the rules are independent, so step 1 to 3 run on -t threads (except the miss flows)
+// the rules are split into blocks of BLOCK_SIZE rules, and every block has its own random engine
+// seeded by a seed drawn from the random engine of the job and the index of the block
+// the flows and the packets of every rule have fixed positions in the trace (by prefix sums)
+// so the trace does not depend on the number of threads, and the threads write it without locks
+// the workers do not touch the global singletons that are created lazily: the field weights are read before they start,
+// and RandomSelector is created before they start (as in trace_batch.hpp)
 
-#include <queue>
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <thread>
 
 #include "exception.hpp"
 #include "trace.hpp"
 #include "rule_set_ud_index.hpp"
-#include "rule_splitter.hpp"
+#include "flow_allocation.hpp"
+#include "flow_enumerator.hpp"
+#include "miss_generator.hpp"
+#include "overlap_sampler.hpp"
+#include "rejection_sampler.hpp"
 #include "rule_output.hpp"
 
 namespace flowbench {
 
-class FlowMapping : public Singleton<FlowMapping> {
+class FlowMapping : public ThreadLocalSingleton<FlowMapping> {
 private:
+    constexpr static uint32_t BLOCK_SIZE = 64;
+
     Trace trace;
 
+    // the first flow ID and the first packet of every rule (prefix sums)
+    std::vector<uint32_t> flowOffsets;
+    std::vector<uint32_t> packetOffsets;
+
 public:
-    const Trace& operator()(UDRuleSetWithIndex& ruleSet, const std::vector<std::vector<uint32_t>>& ruleFlowAllocation);
+    // missAllocation: the packet count of every miss flow
+    const Trace& operator()(const UDRuleSetWithIndex& ruleSet, const FlowAllocation& ruleFlowAllocation,
+                            const std::vector<uint32_t>& missAllocation);
 
 private:
-    void generateFlows(std::unique_ptr<UDRule> rule, uint32_t ruleIndex, const std::vector<uint32_t>& flowAllocation);
+    // the weight of every field, read from the configuration by the job thread
+    std::vector<double> fieldWeights;
+
+    // group: the index of the rule in ruleFlowAllocation
+    // it runs on the worker threads, so it only uses the thread-local random engine and samplers of the worker
+    void generateFlows(const UDRule& rule, uint32_t ruleIndex, const FlowAllocation& ruleFlowAllocation, uint32_t group,
+                       bool enableRejectionMode, uint32_t overlapDepth);
 };
 
-const Trace& FlowMapping::operator()(UDRuleSetWithIndex& ruleSet, const std::vector<std::vector<uint32_t>>& ruleFlowAllocation) {
-    trace.clear();
+constexpr uint32_t FlowMapping::BLOCK_SIZE;
+
+const Trace& FlowMapping::operator()(const UDRuleSetWithIndex& ruleSet, const FlowAllocation& ruleFlowAllocation,
+                                     const std::vector<uint32_t>& missAllocation) {
+    const auto& configuration = TraceConfiguration::getInstance();
+    bool enableRejectionMode = configuration.enableRejectionMode();
+    uint32_t overlapDepth = configuration.getOverlapDepth();
+    trace.clear(configuration.enableStreamMode());
+    flowOffsets.assign(ruleSet.size() + 1, 0);
+    packetOffsets.assign(ruleSet.size() + 1, 0);
     for (uint32_t i = 0; i < ruleSet.size(); i++) {
+        uint32_t flowCount = 0;
+        uint32_t packetCount = 0;
         if (ruleSet[i] != nullptr) {
-            generateFlows(std::move(ruleSet[i]), ruleSet.getRuleIndex(i), ruleFlowAllocation[i]);   
+            flowCount = ruleFlowAllocation.getFlowCount(i);
+            for (uint32_t j = 0; j < flowCount; j++) {
+                packetCount += ruleFlowAllocation.getTraceCount(i, j);
+            }
         }
+        flowOffsets[i + 1] = flowOffsets[i] + flowCount;
+        packetOffsets[i + 1] = packetOffsets[i] + packetCount;
     }
-    std::random_shuffle(trace.begin(), trace.end());
-    return trace;
-}
+    uint32_t missPacketCount = 0;
+    for (auto count : missAllocation) {
+        missPacketCount += count;
+    }
+    trace.resize(flowOffsets.back() + missAllocation.size(), packetOffsets.back() + missPacketCount);
 
-void FlowMapping::generateFlows(std::unique_ptr<UDRule> rule, uint32_t ruleIndex, const std::vector<uint32_t>& flowAllocation) {
-    uint32_t flowCount = flowAllocation.size();
-    std::queue<std::unique_ptr<UDRule>> rules;
-    rules.push(std::move(rule));
-    while (rules.size() < flowCount) {
-        auto rule = std::move(rules.front());
-        rules.pop();
-        auto pair = RuleSplitter::getInstance().split(*rule);
-        if (pair.first != nullptr) {
-            rules.push(std::move(pair.first));
-        } else {
-            throw NoRuleError();
+    fieldWeights.resize(RuleTypeUD::getInstance().getFieldCount());
+    for (uint8_t i = 0; i < fieldWeights.size(); i++) {
+        fieldWeights[i] = Configuration::getInstance().getFieldWeight(i);
+    }
+    RandomSelector::getInstance();
+
+    // the random engine of the job is not used by the workers, so the shuffle below does not depend on the threads
+    uint32_t seed = Random::getInstance().nextUInt32();
+    std::shared_ptr<const RuleOverlapIndex> index;
+    if (enableRejectionMode || !missAllocation.empty() || overlapDepth > 1) {
+        index = RejectionSampler::getInstance().getIndex();
+    }
+    uint32_t blockCount = (ruleSet.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t threadCount = std::max<uint32_t>(std::min(configuration.getThreadCount(), blockCount), 1);
+    std::atomic<uint32_t> next(0);
+    std::vector<uint32_t> relabeledCounts(threadCount, 0);
+    std::vector<std::exception_ptr> errors(threadCount);
+    auto worker = [&](uint32_t t) {
+        try {
+            RejectionSampler::getInstance().setIndex(index);
+            OverlapSampler::getInstance().setIndex(index);
+            for (uint32_t b = next++; b < blockCount; b = next++) {
+                Random::setInstance(seed ^ (b * 0x9e3779b9u));
+                for (uint32_t i = b * BLOCK_SIZE; i < std::min<uint32_t>((b + 1) * BLOCK_SIZE, ruleSet.size()); i++) {
+                    if (ruleSet[i] != nullptr) {
+                        generateFlows(*ruleSet[i], ruleSet.getRuleIndex(i), ruleFlowAllocation, i, enableRejectionMode,
+                                      overlapDepth);
+                    }
+                }
+            }
+            relabeledCounts[t] = RejectionSampler::getInstance().getRelabeledCount();
+        } catch (...) {
+            errors[t] = std::current_exception();
+            next = blockCount;
         }
-        if (pair.second != nullptr) {
-            rules.push(std::move(pair.second));
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < threadCount; t++) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (uint32_t t = 0; t < threadCount; t++) {
+        if (errors[t] != nullptr) {
+            std::rethrow_exception(errors[t]);
+        }
+        RejectionSampler::getInstance().addRelabeledCount(relabeledCounts[t]);
+    }
+    // the miss flows are drawn by the random engine of the job
+    MissGenerator::getInstance().setIndex(index);
+    uint32_t packetOffset = packetOffsets.back();
+    for (uint32_t k = 0; k < missAllocation.size(); k++) {
+        uint32_t flowId = flowOffsets.back() + k;
+        std::unique_ptr<Flow> flow;
+        try {
+            flow = MissGenerator::getInstance().sample();
+        } catch (const NoMissError&) {
+            std::cerr << "No header misses the rules (they cover almost every header), --miss-ratio cannot be met" << std::endl;
+            exit(1);
         }
+        trace.setFlow(flowId, *flow);
+        trace.setPackets(flowId, packetOffset, missAllocation[k]);
+        packetOffset += missAllocation[k];
     }
-    uint32_t flowIndex = 0;
-    while (!rules.empty()) {
-        auto rule = std::move(rules.front());
-        rules.pop();
-        Flow flow(*rule, ruleIndex);
-        // duplicate the flow according to the flow allocation
-        for (uint32_t i = 0; i < flowAllocation[flowIndex]; i++) {
-            trace.push_back(std::move(flow.clone()));
+    trace.shuffle(configuration.getTemporalDistribution(), configuration.getLifetimeDistribution());
+    trace.setRateModel(configuration.getRateModel());
+    return trace;
+}
+
+void FlowMapping::generateFlows(const UDRule& rule, uint32_t ruleIndex, const FlowAllocation& ruleFlowAllocation, uint32_t group,
+                                bool enableRejectionMode, uint32_t overlapDepth) {
+    uint32_t flowCount = ruleFlowAllocation.getFlowCount(group);
+    FlowEnumerator enumerator(rule, flowCount, fieldWeights);
+    uint32_t packetOffset = packetOffsets[group];
+    for (uint32_t flowIndex = 0; flowIndex < flowCount; flowIndex++) {
+        std::unique_ptr<Flow> flow;
+        if (overlapDepth > 1) {
+            flow = OverlapSampler::getInstance().sample(rule, ruleIndex, overlapDepth, enableRejectionMode);
+        } else if (enableRejectionMode) {
+            flow = RejectionSampler::getInstance().sample(enumerator, flowIndex, ruleIndex);
+        } else {
+            flow = enumerator.getFlow(flowIndex, ruleIndex);
         }
-        flowIndex++;
+        // the flow is stored once, and its packets refer to it by the flow ID
+        uint32_t flowId = flowOffsets[group] + flowIndex;
+        uint32_t packetCount = ruleFlowAllocation.getTraceCount(group, flowIndex);
+        trace.setFlow(flowId, *flow);
+        trace.setPackets(flowId, packetOffset, packetCount);
+        packetOffset += packetCount;
     }
 }
 
@@ -4,59 +4,102 @@
 // in the first step, we have splitted the rule set into isolate rules
 // in the second step, we have allocated the traces according to the Pareto distribution
 // in this step, we will build a mapping between the allocation result and the isolate rule set
+// the selected rules are copied, so the isolate rule set can be shared by the jobs in batch mode
+// every rule is selected at most once, the nearest unvisited rule is found by union-find "next free" pointers
+// e.g. visited = 0 1 1 0, next = 0 2 3 3 (4), so the lookup from rule 1 follows 1 -> 2 -> 3
+// with path compression, a lookup takes amortized near O(1) time
+// so the mapping is linear in the number of allocations even if most rules are visited
 
 #include <algorithm>
 #include <numeric>
 
 #include "exception.hpp"
 #include "rule_set_ud_index.hpp"
+#include "flow_allocation.hpp"
 
 namespace flowbench {
 
-class RuleMapping : public Singleton<RuleMapping> {
+class RuleMapping : public ThreadLocalSingleton<RuleMapping> {
 private:
     // share the same index with RuleAllocator's ruleFlowAllocation
     UDRuleSetWithIndex ruleSet;
 
     std::vector<bool> visited;
-    uint32_t findNearestUnvisited(uint32_t index, uint32_t lowerBound) const;
+
+    // next[i]: a rule >= i on the way to the first unvisited rule >= i (next[size] = size)
+    // prev[i + 1]: a rule <= i on the way to the last unvisited rule <= i, shifted by 1 (prev[0] = 0 means none)
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> prev;
+
+    uint32_t findNext(uint32_t index);
+    uint32_t findPrev(uint32_t index);
+    void visit(uint32_t index);
+
+    // the first unvisited rule >= index, or the last unvisited rule in [lowerBound, index]
+    // return visited.size() if there is no such rule
+    uint32_t findNearestUnvisited(uint32_t index, uint32_t lowerBound);
 
 public:
     RuleMapping() = default;
 
-    UDRuleSetWithIndex& operator()(UDRuleSet& isolateRuleSet, std::vector<std::vector<uint32_t>>& ruleFlowAllocation);
+    UDRuleSetWithIndex& operator()(const UDRuleSetWithIndex& isolateRuleSet, FlowAllocation& ruleFlowAllocation);
 };
 
-uint32_t RuleMapping::findNearestUnvisited(uint32_t index, uint32_t lowerBound) const {
-    uint32_t r = index;
-    while (visited[r] && r < visited.size()) {
-        r++;
+uint32_t RuleMapping::findNext(uint32_t index) {
+    while (next[index] != index) {
+        next[index] = next[next[index]]; // path halving
+        index = next[index];
     }
-    if (r == visited.size()) {
-        r = index;
-        while (r >= lowerBound && r < visited.size() && visited[r]) {
-            r--;
-        }
+    return index;
+}
+
+uint32_t RuleMapping::findPrev(uint32_t index) {
+    index++;
+    while (prev[index] != index) {
+        prev[index] = prev[prev[index]];
+        index = prev[index];
+    }
+    return index; // shifted by 1
+}
+
+void RuleMapping::visit(uint32_t index) {
+    visited[index] = true;
+    next[index] = index + 1;
+    prev[index + 1] = index;
+}
+
+uint32_t RuleMapping::findNearestUnvisited(uint32_t index, uint32_t lowerBound) {
+    uint32_t r = findNext(index);
+    if (r < visited.size()) {
+        return r;
+    }
+    r = findPrev(index);
+    if (r == 0 || r - 1 < lowerBound) {
+        return visited.size();
     }
-    return r;
+    return r - 1;
 }
 
-UDRuleSetWithIndex& RuleMapping::operator()(UDRuleSet& isolateRuleSet, std::vector<std::vector<uint32_t>>& ruleFlowAllocation) {
+UDRuleSetWithIndex& RuleMapping::operator()(const UDRuleSetWithIndex& isolateRuleSet, FlowAllocation& ruleFlowAllocation) {
     ruleSet.clear();
-    visited.clear();
-    visited.resize(isolateRuleSet.size());
-    std::fill(visited.begin(), visited.end(), false);
-    for (auto& allocation : ruleFlowAllocation) {
-        if (allocation.empty()) {
+    visited.assign(isolateRuleSet.size(), false);
+    next.resize(isolateRuleSet.size() + 1);
+    std::iota(next.begin(), next.end(), 0);
+    prev.resize(isolateRuleSet.size() + 1);
+    std::iota(prev.begin(), prev.end(), 0);
+    for (uint32_t i = 0; i < ruleFlowAllocation.size(); i++) {
+        if (ruleFlowAllocation.getFlowCount(i) == 0) {
             continue;
         }
-        double log2FlowCount = std::log2(allocation.size());
+        double log2FlowCount = std::log2(ruleFlowAllocation.getFlowCount(i));
         // isolateRuleSet is sorted by available width
         // find the first rule whose available width is larger than log2FlowCount
         // then the rule before it is the largest rule that can hold the allocation
         uint32_t lowerBound = std::lower_bound(isolateRuleSet.begin(), isolateRuleSet.end(), log2FlowCount,
-                                               [](const std::unique_ptr<UDRule>& rule, double value) {
-                                                   return rule == nullptr || rule->getAvailableWidth() < value;
+                                               [&](const std::unique_ptr<UDRule>& rule, double value) {
+                                                   // a selected rule is treated as the narrowest rule
+                                                   return rule == nullptr || visited[&rule - isolateRuleSet.data()] ||
+                                                          rule->getAvailableWidth() < value;
                                                }) - isolateRuleSet.begin();
         uint32_t ruleIndex;
         if (lowerBound < isolateRuleSet.size()) {
@@ -65,9 +108,7 @@ UDRuleSetWithIndex& RuleMapping::operator()(UDRuleSet& isolateRuleSet, std::vect
         }
         if (lowerBound == isolateRuleSet.size() || ruleIndex < lowerBound || ruleIndex >= isolateRuleSet.size()) {
             // no rule can hold the allocation, merge the allocation into one
-            uint32_t sum = std::accumulate(allocation.begin(), allocation.end(), 0);
-            allocation.clear();
-            allocation.push_back(sum);
+            ruleFlowAllocation.merge(i);
             ruleIndex = Random::getInstance().nextInt32(0, isolateRuleSet.size() - 1);
             ruleIndex = findNearestUnvisited(ruleIndex, 0);
         }
@@ -75,8 +116,8 @@ UDRuleSetWithIndex& RuleMapping::operator()(UDRuleSet& isolateRuleSet, std::vect
             // still no rule can hold the allocation, error
             throw NoRuleError();
         }
-        visited[ruleIndex] = true;
-        ruleSet.push_back(std::move(isolateRuleSet[ruleIndex]), ruleIndex);
+        visit(ruleIndex);
+        ruleSet.push_back(isolateRuleSet[ruleIndex]->clone(), isolateRuleSet.getRuleIndex(ruleIndex));
     }
     return ruleSet;
 }
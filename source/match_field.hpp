@@ -4,11 +4,16 @@
 
 #include <memory>
 #include <ostream>
+#include <utility>
 
 #include "match_type.hpp"
 
 namespace flowbench {
 
+// the bound of a field as a left-aligned 128-bit integer (high 64 bits, low 64 bits)
+// fields of different widths can be compared in the same way
+using FieldKey = std::pair<uint64_t, uint64_t>;
+
 class MatchField {
 public:
     virtual MatchType getMatchType() const = 0;
@@ -17,24 +22,41 @@ public:
     virtual bool overlap(const MatchField& other) const = 0;
     virtual bool cover(const MatchField& other) const = 0;
     virtual bool difference(const MatchField& other, std::vector<std::unique_ptr<MatchField>>& out) const = 0;
+    // the field matching the values matched by both fields, or nullptr if they do not overlap
+    virtual std::unique_ptr<MatchField> intersect(const MatchField& other) const = 0;
     virtual bool isWildcard() const = 0;
     virtual std::unique_ptr<MatchField> clone() const = 0;
     virtual void convertFrom(const MatchField& other) {} // convert from other field, for field instantiation (LPM/RM)
     virtual void randomize() {}                          // set a random value, for field instantiation (EM)
     virtual void setParent(const MatchField& parent) {}  // set parent field, for rule instantiation
-    virtual void addSuffix(uint32_t suffix, uint8_t suffixLength) {} // add suffix to field, for rule split
+    virtual bool addSuffix(uint32_t suffix, uint8_t suffixLength) { return true; } // add suffix to field, for rule split (false if the width is not sufficient)
     virtual std::unique_ptr<Integer> hit() const { return nullptr; } // return a random value that hits the field
+    // return a random value that hits the pattern-th of the 2^patternLength equal parts of the field, for flow enumeration
+    // (patternLength <= getAvailableWidth(width), so the values of different parts are different within the width)
+    virtual std::unique_ptr<Integer> hit(uint32_t pattern, uint8_t patternLength, uint8_t width) const { return hit(); }
 
     virtual uint8_t getAvailableWidth(uint8_t width) const {
         return 0;
     }
 
+    // the field matches the keys in [getMinKey(), getMaxKey()], for indexing
+    virtual FieldKey getMinKey() const {
+        return FieldKey(0, 0);
+    }
+    virtual FieldKey getMaxKey() const {
+        return FieldKey(UINT64_MAX, UINT64_MAX);
+    }
+
 public:
     virtual void print(std::ostream& os) const {
         os << "Unknown-field";
     }
 
     virtual void load(std::istream& is) {}
+
+    // binary format, for the isolation cache
+    virtual void serialize(std::ostream& os) const {}
+    virtual void deserialize(std::istream& is) {}
 };
 
 }
\ No newline at end of file
@@ -76,6 +76,16 @@ public:
         return true;
     }
 
+    std::unique_ptr<MatchField> intersect(const MatchField& other) const override {
+        const auto& otherEm = static_cast<const EmField<T>&>(other);
+        if (wildcard) {
+            return otherEm.clone();
+        } else if (otherEm.isWildcard() || value == otherEm.getValue()) {
+            return clone();
+        }
+        return nullptr;
+    }
+
 public:
     // for EM fields
     // 1. wildcard
@@ -90,6 +100,16 @@ public:
     // will be implemented in rule_input.hpp
     void load(std::istream& is) override;
 
+    void serialize(std::ostream& os) const override {
+        value.serialize(os);
+        os.put(wildcard ? 1 : 0);
+    }
+
+    void deserialize(std::istream& is) override {
+        value.deserialize(is);
+        wildcard = is.get() != 0;
+    }
+
 };
 
 template <class T>
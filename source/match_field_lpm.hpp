@@ -2,7 +2,6 @@
 
 #include <queue>
 
-#include "exception.hpp"
 #include "random.hpp"
 #include "match_field_sized.hpp"
 
@@ -38,6 +37,12 @@ public:
         T suffix = Random::getInstance().nextAs<T>() >> prefixLength;
         return std::make_unique<T>(prefix | suffix);
     }
+    // the pattern is appended to the prefix
+    std::unique_ptr<Integer> hit(uint32_t pattern, uint8_t patternLength, uint8_t width) const override {
+        uint8_t length = prefixLength + patternLength;
+        T suffix = Random::getInstance().nextAs<T>() >> length;
+        return std::make_unique<T>(prefix | (T(pattern) << (getBitCount<T>() - length)) | suffix);
+    }
 
 private:
     T getMask() const {
@@ -81,10 +86,18 @@ public:
 public:
     std::unique_ptr<LpmField<T>> mergeWith(const LpmField& other) const;
     LpmField& operator^=(const T& xorMask);
-    void addSuffix(const T& suffix, uint8_t suffixLength) override;
+    // return false (and keep the field unchanged) if there are not enough bits for the suffix
+    bool addSuffix(const T& suffix, uint8_t suffixLength) override;
 
 public:
     bool difference(const MatchField& other, std::vector<std::unique_ptr<MatchField>>& out) const override;
+    // two prefixes overlap only if one covers the other, so the intersection is the longer prefix
+    std::unique_ptr<MatchField> intersect(const MatchField& other) const override {
+        if (!this->overlap(other)) {
+            return nullptr;
+        }
+        return this->cover(other) ? other.clone() : clone();
+    }
 
 public:
     // output format for LPM fields
@@ -99,6 +112,16 @@ public:
 
     // will be implemented in rule_input.hpp
     void load(std::istream& is) override;
+
+    void serialize(std::ostream& os) const override {
+        prefix.serialize(os);
+        os.put(static_cast<char>(prefixLength));
+    }
+
+    void deserialize(std::istream& is) override {
+        prefix.deserialize(is);
+        prefixLength = static_cast<uint8_t>(is.get());
+    }
 };
 
 template <class T>
@@ -139,12 +162,13 @@ LpmField<T>& LpmField<T>::operator^=(const T& xorMask) {
 }
 
 template <class T>
-void LpmField<T>::addSuffix(const T& suffix, uint8_t suffixLength) {
-    if ((prefixLength += suffixLength) > getBitCount<T>()) {
-        throw BitWidthError();
-    } else {
-        prefix |= suffix << (getBitCount<T>() - prefixLength);
+bool LpmField<T>::addSuffix(const T& suffix, uint8_t suffixLength) {
+    if (prefixLength + suffixLength > getBitCount<T>()) {
+        return false;
     }
+    prefixLength += suffixLength;
+    prefix |= suffix << (getBitCount<T>() - prefixLength);
+    return true;
 }
 
 template <class T>
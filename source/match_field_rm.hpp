@@ -35,10 +35,19 @@ public:
     }
 
     void setParent(const MatchField& parent) override;
-    void addSuffix(const T& suffix, uint8_t suffixLength) override;
+
+    // set parent field with arbitrary cut points (for Arbitrary Range)
+    // the field must be converted from a prefix of at most cellBits bits
+    // boundaries: the 2^cellBits+1 absolute boundaries of the cells in the parent field
+    void setParent(const std::vector<uint64_t>& boundaries, uint8_t cellBits);
+
+    // return false (and keep the field unchanged) if the range is too small to be split
+    bool addSuffix(const T& suffix, uint8_t suffixLength) override;
     std::unique_ptr<Integer> hit() const override {
         return std::make_unique<T>(Random::getInstance().nextUInt32(start.getValue(), end.getValue()));
     }
+    // the range is divided in units of the field width, so the parts never exceed the range
+    std::unique_ptr<Integer> hit(uint32_t pattern, uint8_t patternLength, uint8_t width) const override;
 
 public:
     T getMin() const override {
@@ -55,6 +64,7 @@ public:
 
 public:
     bool difference(const MatchField& other, std::vector<std::unique_ptr<MatchField>>& out) const override;
+    std::unique_ptr<MatchField> intersect(const MatchField& other) const override;
 
 public:
     // for RM fields
@@ -65,6 +75,16 @@ public:
     // will be implemented in rule_input.hpp
     void load(std::istream& is) override;
 
+    void serialize(std::ostream& os) const override {
+        start.serialize(os);
+        end.serialize(os);
+    }
+
+    void deserialize(std::istream& is) override {
+        start.deserialize(is);
+        end.deserialize(is);
+    }
+
     uint8_t getAvailableWidth(uint8_t width) const override {
         return 0;
     }
@@ -96,10 +116,42 @@ void RmField<T>::setParent(const MatchField& parent) {
 
 // RM only supports Int32
 template <class T>
-void RmField<T>::addSuffix(const T& suffix, uint8_t suffixLength) {
+void RmField<T>::setParent(const std::vector<uint64_t>& boundaries, uint8_t cellBits) {
+    uint8_t shift = 32 - cellBits;
+    uint64_t min = this->start.getValue();
+    uint64_t max = this->end.getValue();
+    start = T(boundaries[min >> shift]);
+    end = T(boundaries[(max + 1) >> shift] - 1);
+}
+
+// RM only supports Int32
+template <class T>
+bool RmField<T>::addSuffix(const T& suffix, uint8_t suffixLength) {
+    uint64_t range = static_cast<uint64_t>(end.getValue()) - start.getValue() + 1;
+    if ((range >> suffixLength) == 0) {
+        return false;
+    }
     uint32_t step = ((start ^ end) >> suffixLength).getValue() + 1;
     start = T(start.getValue() + suffix.getValue() * step);
     end = T(start.getValue() + step - 1);
+    return true;
+}
+
+// RM only supports Int32
+template <class T>
+std::unique_ptr<Integer> RmField<T>::hit(uint32_t pattern, uint8_t patternLength, uint8_t width) const {
+    uint8_t shift = 32 - width;
+    uint64_t first = start.getValue() >> shift;
+    uint64_t count = (end.getValue() >> shift) - first + 1;
+    // the first unit of the part-th part, part * count >> patternLength without overflow
+    auto bound = [count, patternLength](uint64_t part) {
+        uint64_t mask = (1ull << patternLength) - 1;
+        return part * (count >> patternLength) + (part * (count & mask) >> patternLength);
+    };
+    uint64_t low = first + bound(pattern);
+    uint64_t high = first + bound(pattern + 1ull) - 1;
+    uint64_t unit = low + Random::getInstance().nextUInt32(0, high - low);
+    return std::make_unique<T>(static_cast<uint32_t>(unit << shift));
 }
 
 template <class T>
@@ -117,4 +169,15 @@ bool RmField<T>::difference(const MatchField& other, std::vector<std::unique_ptr
     return true;
 }
 
+template <class T>
+std::unique_ptr<MatchField> RmField<T>::intersect(const MatchField& other) const {
+    const auto& otherRm = static_cast<const RmField<T>&>(other);
+    T min = otherRm.getMin() > start ? otherRm.getMin() : start;
+    T max = otherRm.getMax() < end ? otherRm.getMax() : end;
+    if (min > max) {
+        return nullptr;
+    }
+    return std::make_unique<RmField<T>>(min, max);
+}
+
 }
\ No newline at end of file
@@ -42,14 +42,25 @@ public:
         return cover(static_cast<const SizedField&>(other));
     }
 
+    virtual FieldKey getMinKey() const override {
+        T min = getMin();
+        return FieldKey(min.getHighBits(), min.getLowBits());
+    }
+    virtual FieldKey getMaxKey() const override {
+        T max = getMax();
+        return FieldKey(max.getHighBits(), max.getLowBits());
+    }
+
     virtual bool isWildcard() const {
         return getMin().isZero() && getMax().isMax();
     }
 
-    virtual void addSuffix(const T& suffix, uint8_t suffixLength) {}
+    virtual bool addSuffix(const T& suffix, uint8_t suffixLength) {
+        return true;
+    }
 
-    virtual void addSuffix(uint32_t suffix, uint8_t suffixLength) override {
-        addSuffix(T(suffix), suffixLength);
+    virtual bool addSuffix(uint32_t suffix, uint8_t suffixLength) override {
+        return addSuffix(T(suffix), suffixLength);
     }
 };
 
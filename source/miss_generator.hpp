@@ -0,0 +1,308 @@
+#pragma once
+
+// the miss traffic of the trace (for trace generator, --miss-ratio)
+// every packet of the trace hits a rule, while a classifier takes its slow path (or an upcall) on a miss
+// so a part of the flows are misses: their headers match none of the rules, except the rules matching everything
+// a miss flow is labeled with the last (default) rule matching everything, or MISS_RULE_INDEX if there is none
+// a miss header is drawn as follows, and checked against the overlap index of the rule pool (see rule_overlap_index.hpp)
+// 1. the value of every field hits the same field of a random rule (or is uniformly random after the first restarts)
+//    so the header looks like the hit traffic, and it goes deep into the lookup structures before missing
+// 2. while the header hits a rule, the fields are tried in a random order: with the other fields fixed,
+//    the ranges of the rules matching them on this field are sorted, and the field is moved into a gap between them
+//    (just above or just below a rule), so the header misses every rule
+// 3. if no field has a gap, a random field which a hit rule does not fully cover is moved
+//    just below or above the range of the rule on that field, and 2 is tried again (at most MAX_STEPS moves)
+// so the misses are also close to the boundaries of the rules, the hardest case for a classifier
+// if all the RESTART_COUNT restarts fail (the rules cover almost all the headers), NoMissError is thrown
+// the rules hit recently are checked before querying the index, since a few wide rules reject most of the headers
+
+#include <algorithm>
+
+#include "exception.hpp"
+#include "flow.hpp"
+#include "random.hpp"
+#include "rule_overlap_index.hpp"
+#include "rule_pool.hpp"
+
+namespace flowbench {
+
+class MissGenerator : public ThreadLocalSingleton<MissGenerator> {
+private:
+    constexpr static uint32_t RESTART_COUNT = 8;
+    constexpr static uint32_t MAX_STEPS = 32;
+    constexpr static uint32_t RECENT_RULE_COUNT = 16;
+
+    std::shared_ptr<const RuleOverlapIndex> index;
+
+    // whether every rule of the rule pool matches everything, and the label of the miss flows
+    // (the last rule matching everything, or MISS_RULE_INDEX)
+    std::vector<bool> matchAll;
+    uint32_t defaultRuleIndex = Flow::MISS_RULE_INDEX;
+
+    std::vector<FieldKey> lows;
+    std::vector<FieldKey> highs;
+    std::vector<uint32_t> rules;
+    std::vector<uint32_t> hitRules;
+    std::vector<uint32_t> recentRules; // a ring of the rules hit recently
+    uint32_t recentPosition = 0;
+    std::vector<uint8_t> movableFields;
+    std::vector<uint8_t> fieldOrder;
+    std::vector<std::pair<FieldKey, FieldKey>> ranges;
+    std::vector<FieldKey> gapKeys;
+
+    // a uniformly random value of the field
+    static std::unique_ptr<Integer> nextValue(uint8_t width);
+
+    // the value of a key (the printed bits)
+    static std::unique_ptr<Integer> toValue(FieldKey key, uint8_t width);
+
+    // the next (up) or the previous key on the printed bits
+    static FieldKey step(FieldKey key, uint8_t width, bool up);
+
+    // whether the rule matches every header (on the printed bits)
+    static bool matchesAll(const UDRule& rule);
+
+    // the keys with the same printed bits as the flow, in lows and highs
+    void setBox(const Flow& flow);
+
+    // a random rule which does not match everything and is matched by the flow, or UINT32_MAX
+    uint32_t hit(const Flow& flow);
+
+    // move a field of the flow into a gap between the rules matching its other fields
+    // return false if no field has a gap
+    bool escape(Flow& flow);
+
+    // move a field of the flow out of the rule
+    void move(Flow& flow, const UDRule& rule);
+
+public:
+    MissGenerator() = default;
+
+    // set the index of the rule pool before drawing the miss flows of a trace
+    // the rules hit recently are forgotten, so the miss flows of a trace only depend on its own random engine
+    void setIndex(const std::shared_ptr<const RuleOverlapIndex>& index) {
+        this->index = index;
+        recentRules.clear();
+        recentPosition = 0;
+    }
+
+    // draw a miss flow, throw NoMissError if no miss is found
+    std::unique_ptr<Flow> sample();
+};
+
+constexpr uint32_t MissGenerator::RESTART_COUNT;
+constexpr uint32_t MissGenerator::MAX_STEPS;
+constexpr uint32_t MissGenerator::RECENT_RULE_COUNT;
+
+std::unique_ptr<Integer> MissGenerator::nextValue(uint8_t width) {
+    if (width <= 32) {
+        return std::make_unique<Int32>(Random::getInstance().nextAs<Int32>());
+    } else if (width <= 64) {
+        return std::make_unique<Int64>(Random::getInstance().nextAs<Int64>());
+    }
+    return std::make_unique<Int128>(Random::getInstance().nextAs<Int128>());
+}
+
+std::unique_ptr<Integer> MissGenerator::toValue(FieldKey key, uint8_t width) {
+    if (width <= 32) {
+        return std::make_unique<Int32>(key.first >> 32);
+    } else if (width <= 64) {
+        return std::make_unique<Int64>(key.first);
+    }
+    return std::make_unique<Int128>(key.first, key.second);
+}
+
+FieldKey MissGenerator::step(FieldKey key, uint8_t width, bool up) {
+    key = Flow::truncate(key, width);
+    if (width <= 64) {
+        uint64_t unit = 1ull << (64 - width);
+        key.first = up ? key.first + unit : key.first - unit;
+    } else {
+        uint64_t unit = width == 128 ? 1 : 1ull << (128 - width);
+        uint64_t low = up ? key.second + unit : key.second - unit;
+        if (up && low < key.second) { // carry
+            key.first++;
+        } else if (!up && low > key.second) { // borrow
+            key.first--;
+        }
+        key.second = low;
+    }
+    return key;
+}
+
+bool MissGenerator::matchesAll(const UDRule& rule) {
+    for (uint8_t i = 0; i < rule.getFieldCount(); i++) {
+        uint8_t width = RuleTypeUD::getInstance().getFieldWidth(i);
+        if (Flow::truncate(rule.getField(i).getMinKey(), width) != FieldKey(0, 0) ||
+            Flow::truncate(rule.getField(i).getMaxKey(), width) != Flow::truncate(FieldKey(UINT64_MAX, UINT64_MAX), width)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MissGenerator::setBox(const Flow& flow) {
+    uint8_t fieldCount = RuleTypeUD::getInstance().getFieldCount();
+    lows.resize(fieldCount);
+    highs.resize(fieldCount);
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        uint8_t width = RuleTypeUD::getInstance().getFieldWidth(i);
+        const auto& value = flow.getField(i);
+        lows[i] = Flow::truncate(FieldKey(value.getHighBits(), value.getLowBits()), width);
+        highs[i] = lows[i];
+        if (width < 64) {
+            highs[i].first |= UINT64_MAX >> width;
+            highs[i].second = UINT64_MAX;
+        } else if (width < 128) {
+            highs[i].second |= UINT64_MAX >> (width - 64);
+        }
+    }
+}
+
+uint32_t MissGenerator::hit(const Flow& flow) {
+    for (auto ruleIndex : recentRules) {
+        if (flow.match(RulePool::getInstance().getRule(ruleIndex))) {
+            return ruleIndex;
+        }
+    }
+    setBox(flow);
+    index->query(lows, highs, rules);
+    hitRules.clear();
+    for (auto ruleIndex : rules) {
+        if (!matchAll[ruleIndex] && flow.match(RulePool::getInstance().getRule(ruleIndex))) {
+            hitRules.push_back(ruleIndex);
+        }
+    }
+    if (hitRules.empty()) {
+        return UINT32_MAX;
+    }
+    uint32_t ruleIndex = hitRules[Random::getInstance().nextUInt32(0, hitRules.size() - 1)];
+    if (recentRules.size() < RECENT_RULE_COUNT) {
+        recentRules.push_back(ruleIndex);
+    } else {
+        recentRules[recentPosition++ % RECENT_RULE_COUNT] = ruleIndex;
+    }
+    return ruleIndex;
+}
+
+bool MissGenerator::escape(Flow& flow) {
+    const auto& rulePool = RulePool::getInstance();
+    uint8_t fieldCount = RuleTypeUD::getInstance().getFieldCount();
+    fieldOrder.resize(fieldCount);
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        fieldOrder[i] = i;
+    }
+    for (uint8_t i = fieldCount; i > 1; i--) {
+        std::swap(fieldOrder[i - 1], fieldOrder[Random::getInstance().nextUInt32(0, i - 1)]);
+    }
+    setBox(flow);
+    for (auto i : fieldOrder) {
+        uint8_t width = RuleTypeUD::getInstance().getFieldWidth(i);
+        const FieldKey maxKey = Flow::truncate(FieldKey(UINT64_MAX, UINT64_MAX), width);
+        // the ranges on field i of the rules matching the other fields
+        FieldKey low = lows[i];
+        FieldKey high = highs[i];
+        lows[i] = FieldKey(0, 0);
+        highs[i] = FieldKey(UINT64_MAX, UINT64_MAX);
+        index->query(lows, highs, rules);
+        lows[i] = low;
+        highs[i] = high;
+        ranges.clear();
+        for (auto ruleIndex : rules) {
+            if (!matchAll[ruleIndex]) {
+                const auto& field = rulePool.getRule(ruleIndex).getField(i);
+                ranges.emplace_back(Flow::truncate(field.getMinKey(), width), Flow::truncate(field.getMaxKey(), width));
+            }
+        }
+        std::sort(ranges.begin(), ranges.end());
+        // the keys just below and just above the rules which are not covered by the other rules
+        gapKeys.clear();
+        if (ranges.empty()) {
+            continue;
+        }
+        if (ranges.front().first != FieldKey(0, 0)) {
+            gapKeys.push_back(step(ranges.front().first, width, false));
+        }
+        FieldKey end = ranges.front().second;
+        for (const auto& range : ranges) {
+            if (end == maxKey) {
+                break;
+            }
+            if (step(end, width, true) < range.first) {
+                gapKeys.push_back(step(end, width, true));
+                gapKeys.push_back(step(range.first, width, false));
+            }
+            end = std::max(end, range.second);
+        }
+        if (end != maxKey) {
+            gapKeys.push_back(step(end, width, true));
+        }
+        if (!gapKeys.empty()) {
+            FieldKey key = gapKeys[Random::getInstance().nextUInt32(0, gapKeys.size() - 1)];
+            flow.setField(i, toValue(key, width));
+            return true;
+        }
+    }
+    return false;
+}
+
+void MissGenerator::move(Flow& flow, const UDRule& rule) {
+    // the fields where the rule does not match every value
+    const FieldKey maxKey(UINT64_MAX, UINT64_MAX);
+    movableFields.clear();
+    for (uint8_t i = 0; i < rule.getFieldCount(); i++) {
+        uint8_t width = RuleTypeUD::getInstance().getFieldWidth(i);
+        if (Flow::truncate(rule.getField(i).getMinKey(), width) != FieldKey(0, 0) ||
+            Flow::truncate(rule.getField(i).getMaxKey(), width) != Flow::truncate(maxKey, width)) {
+            movableFields.push_back(i);
+        }
+    }
+    uint8_t i = movableFields[Random::getInstance().nextUInt32(0, movableFields.size() - 1)];
+    uint8_t width = RuleTypeUD::getInstance().getFieldWidth(i);
+    FieldKey min = Flow::truncate(rule.getField(i).getMinKey(), width);
+    FieldKey max = Flow::truncate(rule.getField(i).getMaxKey(), width);
+    bool below = min != FieldKey(0, 0);
+    bool above = max != Flow::truncate(maxKey, width);
+    if (below && above) {
+        below = Random::getInstance().nextUInt32(0, 1) == 0;
+    }
+    flow.setField(i, toValue(below ? step(min, width, false) : step(max, width, true), width));
+}
+
+std::unique_ptr<Flow> MissGenerator::sample() {
+    const auto& rulePool = RulePool::getInstance();
+    if (matchAll.size() != rulePool.size()) {
+        matchAll.resize(rulePool.size());
+        for (uint32_t i = 0; i < rulePool.size(); i++) {
+            matchAll[i] = matchesAll(rulePool.getRule(i));
+            if (matchAll[i]) {
+                defaultRuleIndex = i;
+            }
+        }
+    }
+    uint8_t fieldCount = RuleTypeUD::getInstance().getFieldCount();
+    for (uint32_t restart = 0; restart < RESTART_COUNT; restart++) {
+        auto flow = std::make_unique<Flow>(fieldCount);
+        for (uint8_t i = 0; i < fieldCount; i++) {
+            if (restart < RESTART_COUNT / 2 && rulePool.size() > 0) {
+                const auto& rule = rulePool.getRule(Random::getInstance().nextUInt32(0, rulePool.size() - 1));
+                flow->setField(i, rule.getField(i).hit());
+            } else {
+                flow->setField(i, nextValue(RuleTypeUD::getInstance().getFieldWidth(i)));
+            }
+        }
+        for (uint32_t s = 0; s <= MAX_STEPS; s++) {
+            uint32_t ruleIndex = hit(*flow);
+            if (ruleIndex == UINT32_MAX) {
+                flow->setRuleIndex(defaultRuleIndex);
+                return flow;
+            }
+            if (s < MAX_STEPS && !escape(*flow)) {
+                move(*flow, rulePool.getRule(ruleIndex));
+            }
+        }
+    }
+    throw NoMissError();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+// overlap-targeted flows (for trace generator, --overlap-depth)
+// a flow drawn anywhere in its rule usually matches only a few rules, while a classifier works the hardest
+// on the headers matched by many overlapping rules, where the priority has to be resolved
+// so the flow of rule i is drawn in a deep overlap region instead
+// 1. the lower-priority rules overlapping with rule i are found by the overlap index of the rule pool
+// 2. the region starts as the rule of the flow (rule i, or an isolate rule of it),
+//    and it is intersected with these rules in a random order (see MatchField::intersect)
+//    every non-empty intersection is kept, until the region is inside depth rules (rule i included)
+//    or MAX_TRIALS rules are tried, so the region sits at the bottom of a chain of overlapping rules
+// 3. the flow is drawn in the region, so it matches all the rules of the chain
+// the higher-priority rules are never intersected, so rule i is still the first rule hit by the flow
+// in isolation mode the region is inside the isolate rule, and the label is exact
+// in rejection mode the flow is checked against the higher-priority rules, and a new region is drawn on a hit
+// (at most MAX_ATTEMPTS times, then the flow is relabeled, see rejection_sampler.hpp)
+// the flows are not enumerated (see flow_enumerator.hpp), so two flows of a narrow region may have the same header
+
+#include "flow.hpp"
+#include "random.hpp"
+#include "rejection_sampler.hpp"
+#include "rule_overlap_index.hpp"
+#include "rule_pool.hpp"
+
+namespace flowbench {
+
+class OverlapSampler : public ThreadLocalSingleton<OverlapSampler> {
+private:
+    constexpr static uint32_t MAX_ATTEMPTS = 64;
+    constexpr static uint32_t MAX_TRIALS = 256;
+
+    std::shared_ptr<const RuleOverlapIndex> index;
+
+    // the lower-priority rules overlapping with the rule of ruleIndex (cached for the last rule)
+    uint32_t ruleIndex = UINT32_MAX;
+    std::vector<uint32_t> lowerRules;
+    std::vector<uint32_t> order;
+
+    // a random region inside the rule and at most depth - 1 lower-priority rules
+    std::unique_ptr<UDRule> getRegion(const UDRule& rule, uint32_t depth);
+
+public:
+    OverlapSampler() = default;
+
+    void setIndex(const std::shared_ptr<const RuleOverlapIndex>& index) {
+        this->index = index;
+        ruleIndex = UINT32_MAX;
+    }
+
+    // draw a flow of the rule in an overlap region of depth rules, the rule is the ruleIndex-th rule of the rule pool
+    // (or an isolate rule of it)
+    std::unique_ptr<Flow> sample(const UDRule& rule, uint32_t ruleIndex, uint32_t depth, bool enableRejectionMode);
+};
+
+constexpr uint32_t OverlapSampler::MAX_ATTEMPTS;
+constexpr uint32_t OverlapSampler::MAX_TRIALS;
+
+std::unique_ptr<UDRule> OverlapSampler::getRegion(const UDRule& rule, uint32_t depth) {
+    const auto& rulePool = RulePool::getInstance();
+    auto region = rule.clone();
+    // a partial Fisher-Yates shuffle, the order does not depend on the previous flows
+    order = lowerRules;
+    uint32_t trialCount = std::min<uint32_t>(order.size(), MAX_TRIALS);
+    for (uint32_t t = 0, count = 1; t < trialCount && count < depth; t++) {
+        std::swap(order[t], order[Random::getInstance().nextUInt32(t, order.size() - 1)]);
+        auto intersection = region->intersect(rulePool.getRule(order[t]));
+        if (intersection != nullptr) {
+            region = std::move(intersection);
+            count++;
+        }
+    }
+    return region;
+}
+
+std::unique_ptr<Flow> OverlapSampler::sample(const UDRule& rule, uint32_t ruleIndex, uint32_t depth, bool enableRejectionMode) {
+    if (this->ruleIndex != ruleIndex) {
+        this->ruleIndex = ruleIndex;
+        index->query(RulePool::getInstance().getRule(ruleIndex), 0, ruleIndex, lowerRules);
+    }
+    auto flow = std::make_unique<Flow>(*getRegion(rule, depth), ruleIndex);
+    if (!enableRejectionMode) {
+        return flow;
+    }
+    auto& rejectionSampler = RejectionSampler::getInstance();
+    uint32_t firstHit = rejectionSampler.getFirstHit(*flow, ruleIndex);
+    for (uint32_t i = 1; i < MAX_ATTEMPTS && firstHit != ruleIndex; i++) {
+        flow = std::make_unique<Flow>(*getRegion(rule, depth), ruleIndex);
+        firstHit = rejectionSampler.getFirstHit(*flow, ruleIndex);
+    }
+    if (firstHit != ruleIndex) {
+        flow->setRuleIndex(firstHit);
+        rejectionSampler.addRelabeledCount(1);
+    }
+    return flow;
+}
+
+}
\ No newline at end of file
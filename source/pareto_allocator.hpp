@@ -1,29 +1,45 @@
 #pragma once
 
 // Pareto allocator
-// we will allocate n traces to some flows according to the Pareto distribution
+// we will allocate n traces to some flows according to the Pareto distribution (or another CountDistribution)
+// the copy counts are drawn in blocks of at most BLOCK_SIZE
+// if the number of flows is limited, the remaining traces are allocated by a multinomial draw
 
 #include <algorithm>
 #include <vector>
 #include <numeric>
 
 #include "random.hpp"
-#include "pareto_distribution.hpp"
+#include "count_distribution.hpp"
+#include "binomial_distribution.hpp"
 
 namespace flowbench {
 
 class ParetoAllocator : public Singleton<ParetoAllocator> {
+private:
+    constexpr static uint32_t BLOCK_SIZE = 256;
+
 public:
     ParetoAllocator() = default;
 
-    std::vector<uint32_t> allocate(uint32_t traceCount, uint32_t groupCount, const ParetoDistribution& distribution) const;
+    std::vector<uint32_t> allocate(uint32_t traceCount, uint32_t groupCount, const CountDistribution& distribution) const;
 };
 
-std::vector<uint32_t> ParetoAllocator::allocate(uint32_t traceCount, uint32_t groupCount, const ParetoDistribution& distribution) const {
+constexpr uint32_t ParetoAllocator::BLOCK_SIZE;
+
+std::vector<uint32_t> ParetoAllocator::allocate(uint32_t traceCount, uint32_t groupCount, const CountDistribution& distribution) const {
     std::vector<uint32_t> result;
     uint32_t remain = traceCount;
+    // a block never has more counts than the traces or the groups left (every count is at least 1)
+    std::vector<uint32_t> block;
+    uint32_t used = 0;
     while (remain > 0) {
-        uint32_t count = distribution.copyCount();
+        if (used == block.size()) {
+            block.resize(std::min<uint64_t>(std::min(BLOCK_SIZE, remain), groupCount - result.size()));
+            distribution.fill(block);
+            used = 0;
+        }
+        uint32_t count = block[used++];
         if (count > remain) {
             count = remain;
         }
@@ -34,25 +50,18 @@ std::vector<uint32_t> ParetoAllocator::allocate(uint32_t traceCount, uint32_t gr
         }
     }
     if (remain > 0) {
-        // we need to allocate the remain traces to the groups
-        std::vector<double> weights;
-        weights.resize(result.size());
-        for (uint32_t i = 0; i < result.size(); i++) {
-            weights[i] = result[i];
-        }
-        double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
-        for (uint32_t i = 1; i < weights.size(); i++) {
-            weights[i] += weights[i - 1];
-        }
-        for (uint32_t i = 0; i < weights.size(); i++) {
-            weights[i] /= sum;
-        }
-        weights[weights.size() - 1] = 1.0;
-        while (remain > 0) {
-            double r = Random::getInstance().nextDouble(0, 1);
-            uint32_t index = std::lower_bound(weights.begin(), weights.end(), r) - weights.begin();
-            result[index]++;
-            remain--;
+        // we need to allocate the remain traces to the groups, in proportion to the traces they have
+        // that is a multinomial draw, which is split into a binomial draw per group
+        // the i-th group gets Binomial(remain, weight[i] / (weight[i] + ... + weight[g - 1])) traces
+        double weight = std::accumulate(result.begin(), result.end(), 0.0);
+        for (uint32_t i = 0; i < result.size() && remain > 0; i++) {
+            uint32_t count = remain;
+            if (i + 1 < result.size()) {
+                count = BinomialDistribution(remain, std::min(result[i] / weight, 1.0)).sample();
+            }
+            weight -= result[i];
+            result[i] += count;
+            remain -= count;
         }
     }
     return result;
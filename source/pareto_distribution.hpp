@@ -1,14 +1,18 @@
 #pragma once
 
 // we use Pareto distribution to control the spatial locality of the traces
+// the copy count is ceil(beta / (1 - p)^(1 / alpha)), where p is uniform in [0, 1)
+// a block of p is drawn first, and then transformed in a branch-free loop
+// alpha = 1 (the most common case) needs no pow
 
+#include <algorithm>
 #include <cmath>
 
-#include "random.hpp"
+#include "count_distribution.hpp"
 
 namespace flowbench {
 
-class ParetoDistribution {
+class ParetoDistribution : public CountDistribution {
 private:
     double alpha;
     double beta;
@@ -24,29 +28,42 @@ public:
         return beta;
     }
 
-    void setAlpha(double alpha) {
-        this->alpha = alpha;
-    }
+    using CountDistribution::fill;
+    void fill(std::vector<uint32_t>& block, UniformSource& source) const override;
 
-    void setBeta(double beta) {
-        this->beta = beta;
+    // alpha = 0 means the distribution is not specified
+    bool isDisabled() const override {
+        return alpha == 0.0;
     }
 
-    uint32_t copyCount() const {
-        if (beta == 0.0) {
-            return 1;
-        }
-        double p = Random::getInstance().nextDouble(0.0, 1.0 - 1e-9);
-        double result = beta / std::pow(1.0 - p, 1.0 / alpha);
-        return std::ceil(result);
+    void print(std::ostream& os) const override {
+        os << "Pareto(" << alpha << ", " << beta << ")";
     }
 
-    static ParetoDistribution ruleDistribution;
-    static ParetoDistribution flowDistribution;
-
+    std::unique_ptr<CountDistribution> clone() const override {
+        return std::make_unique<ParetoDistribution>(alpha, beta);
+    }
 };
 
-ParetoDistribution ParetoDistribution::ruleDistribution(0.0, 0.0);
-ParetoDistribution ParetoDistribution::flowDistribution(1.0, 1.0);
+void ParetoDistribution::fill(std::vector<uint32_t>& block, UniformSource& source) const {
+    if (beta == 0.0) {
+        std::fill(block.begin(), block.end(), 1);
+        return;
+    }
+    std::vector<double> q(block.size());
+    for (auto& x : q) {
+        x = 1.0 - source.nextDouble(0.0, 1.0 - 1e-9);
+    }
+    if (alpha == 1.0) {
+        for (uint32_t i = 0; i < block.size(); i++) {
+            block[i] = std::ceil(std::min(beta / q[i], 4294967295.0));
+        }
+    } else {
+        double exponent = 1.0 / alpha;
+        for (uint32_t i = 0; i < block.size(); i++) {
+            block[i] = std::ceil(std::min(beta / std::pow(q[i], exponent), 4294967295.0));
+        }
+    }
+}
 
 }
\ No newline at end of file
@@ -31,12 +31,15 @@
 //                     so the rule count is limited by about (1 ~ 4/3) * 4^((w - h) / 5)
 // from the information above, we design the following algorithm:
 // 1. at the beginning, h = 0 (partCount p = 2^h, internal trie node number t = 2^h-1)
+//    i.e. the whole problem starts from the wildcard
 // 2. besides the internal trie nodes, we have n - t nodes to be allocated to p sub-problems
 // 3. from the formula above, we can calculate the maximum rule count of a sub-problem N
 // 4. if N * p >= n - t, we can satisfy the rule count requirement
 //    otherwise, the partition fails
 // 5. try to allocate the n - t nodes to p sub-problems
 //    guarantee that the maximum parameter reaches the requirement
+// since the capacity of the trie (about 2^h * N) grows with h
+// we find the smallest h satisfying 4 by binary search, and then increase h until 5 succeeds
 
 #include "partition_dense_trie.hpp"
 #include "partition.hpp"
@@ -57,6 +60,23 @@ public:
     // otherwise, return true
     bool addPartition();
 
+private:
+    // the log2 of the maximum rule count of a sub-problem, N >= 4 ^ (w - h) / 5
+    double log2NOf(uint32_t height) const {
+        return 0.4 * (totalWidth - height);
+    }
+
+    // whether we have enough bits to represent the trie of the height
+    // once a height is invalid, all the larger heights are invalid
+    bool isValidHeight(uint32_t height) const {
+        if (totalWidth < height) { // we have no bits to represent the trie
+            return false;
+        }
+        // otherwise, we may use too many bits to represent the trie
+        return !(n > p - 1 && log2NOf(height) < std::log2(static_cast<double>(n - p + 1) / p));
+    }
+
+public:
     // export the origins of the sub-problems
     // if the partition is not finished, return false
     // otherwise, return true
@@ -64,22 +84,27 @@ public:
 };
 
 bool DensePartition::addPartition() {
-    h++;
-    if (totalWidth < h) { // we have no bits to represent the trie
-        return false;
-    }
-    double log2N = 0.4 * (totalWidth - h); // N >= 4 ^ (w - h) / 5
-    if (n > p - 1 && log2N < std::log2(static_cast<double>(n - p + 1) / p)) { // we use too many bits to represent the trie
-        return false;
+    auto& trie = DensePartitionTrie::getInstance();
+    // find the smallest height which is invalid or whose trie can hold all the rules
+    uint32_t low = h + 1, high = totalWidth + 1;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (!isValidHeight(mid) || trie.canHold(n, mid, log2NOf(mid))) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
     }
-    if (DensePartitionTrie::getInstance().build(n, h, p, log2N)) { // the trie is too balanced
-        return true;
+    for (h = low; isValidHeight(h); h++) {
+        if (trie.build(n, h, p, log2NOf(h))) { // the trie is not too balanced
+            return true;
+        }
     }
-    return addPartition();
+    return false;
 }
 
 bool DensePartition::exportOrigins(UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>> &origins) const {
-    return DensePartitionTrie::getInstance().exportOrigins(finalSet, origins);
+    return DensePartitionTrie::getInstance().exportOrigins(n, p, finalSet, origins);
 }
 
 }
\ No newline at end of file
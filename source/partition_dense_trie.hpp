@@ -11,37 +11,39 @@
 //    and caculate the maxmimum parameter of the trie
 
 #include <queue>
+#include <vector>
 
 #include "parameter_calculator.hpp"
 #include "rule_set.hpp"
 #include "problem_state.hpp"
 #include "rule_splitter.hpp"
 
+// the trie is a prefix (in pre-order) of the complete binary tree of height h
+// because the nodes are built in pre-order and the building stops when no rule remains
+// 1. an internal node takes 1 rule
+// 2. a leaf node at depth h takes N rules (a "full" leaf) if the remaining rules cannot be stored in it
+//    otherwise, it takes all the remaining rules
+// 3. a node takes the last rule as a leaf even if its depth < h
+// so the trie is implicit: a node is identified by (depth, pre-order rank)
+//    the left  child of the node (d, r) is (d + 1, r + 1)
+//    the right child of the node (d, r) is (d + 1, r + 2^(h-d))
+//    and the node exists iff r < the node count of the trie
+// and the attributes of the trie can be calculated in closed form:
+//    before the j-th leaf of the complete tree, there are I(j) = h + j - popcount(j) internal nodes
+//    so the first k leaves are full, where k is the first j whose remaining rules n - I(j) - jN can be stored
+//    after that, there is a tail path (the tz(k) internal nodes on the way to the k-th leaf) and a tail leaf
+//    the internal parameter (the sum of the descendant counts of the internal nodes)
+//    is the sum of the depths of all nodes
+
 namespace flowbench {
 
 class DensePartitionTrie : public Singleton<DensePartitionTrie> {
 private:
-    class TrieNode {
-    public:
-        std::array<std::shared_ptr<TrieNode>, 2> children;
-        uint32_t count;
-        bool isLeaf;
-
-        TrieNode() : count(0), isLeaf(false) {
-            children[0] = nullptr;
-            children[1] = nullptr;
-        }
-
-        TrieNode(uint32_t count) : count(count), isLeaf(false) {
-            children[0] = nullptr;
-            children[1] = nullptr;
-        }
-    };
-
-    std::shared_ptr<TrieNode> root;
+    uint32_t height = 0;    // the height of the trie
+    uint64_t nodeCount = 0; // the node count of the trie (0 if the trie is not built)
 
 public:
-    DensePartitionTrie() : root(nullptr) {}
+    DensePartitionTrie() = default;
     
     // return false when:
     // 1. node count is too small (the node count n is smaller than any h-height trie)
@@ -51,15 +53,46 @@ public:
     // otherwise, return true
     bool build(uint32_t n, uint32_t h, uint32_t p, double log2N);
 
+    // whether all the n rules can be allocated to a h-height trie (case 2 above does not happen)
+    // the capacity of a trie grows with h, so the smallest h can be found by binary search
+    bool canHold(uint32_t n, uint32_t h, double log2N) const {
+        return layout(n, h, log2N).remaining == 0;
+    }
+
 private:
-    // build a trie node recursively
-    // node: the node to be built
-    // n   : the remaining rule count
-    // h   : the height of the trie
-    // depth: the depth of the node
-    // log2N: log2 (the maximum rule count of a sub-problem) (N may be too large to be stored in a uint32_t)
-    // return the node count of the trie
-    uint32_t buildTrieNode(std::shared_ptr<TrieNode>& node, uint32_t& n, uint32_t h, uint32_t depth, double log2N);
+    // the shape of a trie built with n rules
+    struct Layout {
+        uint64_t fullLeaves = 0;    // the count of full leaves (k)
+        uint64_t fullInternals = 0; // the count of internal nodes before the tail path
+        uint32_t tailInternals = 0; // the count of internal nodes on the tail path (m)
+        uint32_t tailDepth = 0;     // the depth of the first node on the tail path
+        uint64_t tailLeaf = 0;      // the count of rules in the tail leaf (0 if there is no tail leaf)
+        uint64_t remaining = 0;     // the count of rules which cannot be allocated
+        uint32_t fullCount = 0;     // the count of rules in a full leaf (N)
+    };
+
+    // whether r rules can be stored in a single leaf
+    static bool fits(uint64_t r, double log2N) {
+        return std::log2(r) <= log2N;
+    }
+
+    // the count of internal nodes before the j-th leaf of the complete tree
+    static uint64_t internalsBefore(uint64_t j, uint32_t h) {
+        return h + j - popcount(j);
+    }
+
+    static uint32_t popcount(uint64_t x) {
+        uint32_t count = 0;
+        for (; x != 0; x &= x - 1) {
+            count++;
+        }
+        return count;
+    }
+
+    // the sum of the depths of the nodes on the paths from the root to the first k leaves
+    static uint64_t depthSum(uint64_t k, uint32_t h);
+
+    Layout layout(uint32_t n, uint32_t h, double log2N) const;
 
 private:
     // the attributes of the trie
@@ -101,27 +134,40 @@ private:
 
 public:
     // export the origins of the sub-problems (the leaf nodes)
-    //        and the solid rules (the internal nodes) recursively
+    //        and the solid rules (the internal nodes)
     // use a pre-post-order traversal
+    // if the trie is not built, export the whole problem as a single origin
+    // n: the rule count of the total problem
     // p: the parameter of the total problem
     // finalSet: the final rule set
     // origins: the queue of the origins of the sub-problems
-    bool exportOrigins(UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>> &origins) {
-        std::unique_ptr<UDRule> rule = std::make_unique<UDRule>();
-        exportNoError = true;
-        exportOrigins(root, std::move(rule), finalSet, origins);
-        return exportNoError;
-    }
+    bool exportOrigins(uint32_t n, uint32_t p, UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>> &origins);
 
 private:
-    // the pre-post-order traversal
-    // pre-order:  rule split
+    // a node on the traversal stack
+    // stage 0: not visited, 1: the left subtree is exported, 2: the right subtree is exported
+    struct Frame {
+        uint64_t rank;
+        uint32_t depth;
+        uint8_t stage;
+        std::unique_ptr<UDRule> rule;
+        std::unique_ptr<UDRule> right; // the right part of the rule, kept until the right subtree is visited
+    };
+
+    // the pre-order rank of the right child of the node (depth, rank)
+    uint64_t rightChildOf(uint64_t rank, uint32_t depth) const {
+        uint32_t shift = height - depth;
+        return shift >= 40 ? UINT64_MAX : rank + (1ull << shift); // a trie never has 2^40 nodes
+    }
+
+    bool isLeaf(uint64_t rank, uint32_t depth) const {
+        return depth == height || rank + 1 == nodeCount;
+    }
+
     // reach leaf: export the origin of the sub-problem
     //             there are 3 types of partitions
-    // post-order: export the solid rule
-    void exportOrigins(std::shared_ptr<TrieNode> node, std::unique_ptr<UDRule> rule, UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>> &origins);
+    void exportLeaf(std::unique_ptr<UDRule> rule, std::queue<std::unique_ptr<ProblemState>> &origins);
     uint32_t leafIndex = 0;
-    bool exportNoError = true;
 
 };
 
@@ -140,92 +186,173 @@ void DensePartitionTrie::arrangePartitions(uint32_t n, uint32_t p) {
     leafIndex = 0;
 }
 
+uint64_t DensePartitionTrie::depthSum(uint64_t k, uint32_t h) {
+    if (k == 0) {
+        return 0;
+    }
+    // the nodes at depth d on the paths are the ancestors of the leaves 0 ~ k-1
+    // i.e. the first ((k-1) >> (h-d)) + 1 nodes at depth d
+    uint64_t sum = 0;
+    for (uint32_t d = 1; d <= h; d++) {
+        uint32_t shift = h - d;
+        sum += d * ((shift >= 64 ? 0 : (k - 1) >> shift) + 1);
+    }
+    return sum;
+}
+
+DensePartitionTrie::Layout DensePartitionTrie::layout(uint32_t n, uint32_t h, double log2N) const {
+    Layout result;
+    uint64_t leaves = h >= 40 ? UINT64_MAX : 1ull << h;
+    // the remaining rules before the j-th leaf, if the leaves 0 ~ j-1 are full
+    auto remainingAt = [&](uint64_t j) -> int64_t {
+        return static_cast<int64_t>(n) - static_cast<int64_t>(internalsBefore(j, h)) - static_cast<int64_t>(j * result.fullCount);
+    };
+    if (!fits(n, log2N)) { // otherwise there is no full leaf and N is not needed
+        result.fullCount = std::round(std::exp2(log2N));
+        // the j-th leaf is full iff it has more remaining rules than it can store
+        // the remaining rules decrease with j, so the full leaves can be found by binary search
+        uint64_t low = 0, high = std::min<uint64_t>(leaves, n / result.fullCount + 1);
+        while (low < high) {
+            uint64_t mid = (low + high) / 2;
+            int64_t r = remainingAt(mid);
+            if (r > 0 && !fits(r, log2N)) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        result.fullLeaves = low;
+    }
+    uint64_t k = result.fullLeaves;
+    uint64_t r = n;
+    if (k > 0) {
+        result.fullInternals = internalsBefore(k - 1, h);
+        r = remainingAt(k - 1) - result.fullCount;
+    }
+    if (k == leaves) { // all the leaves are full
+        result.remaining = r;
+        return result;
+    }
+    if (r == 0) { // no tail path
+        return result;
+    }
+    // the path to the k-th leaf starts at the lowest common ancestor of the (k-1)-th and the k-th leaves
+    uint32_t pathLength = h;
+    if (k > 0) {
+        pathLength = 0;
+        for (uint64_t x = k; (x & 1) == 0; x >>= 1) {
+            pathLength++;
+        }
+    }
+    result.tailDepth = h - pathLength;
+    result.tailInternals = std::min<uint64_t>(pathLength, r - 1);
+    result.tailLeaf = r - result.tailInternals;
+    return result;
+}
+
 bool DensePartitionTrie::build(uint32_t n, uint32_t h, uint32_t p, double log2N) {
     clearAttributes();
-    uint32_t sumOfCount = n;
-    buildTrieNode(root, n, h, 0, log2N);
+    height = h;
+    nodeCount = 0;
+    Layout shape = layout(n, h, log2N);
+    if (shape.remaining != 0) { // the node count is too large for a h-height trie
+        return false;
+    }
+    // the full leaves are large partitions
+    largeCount = shape.fullLeaves;
+    if (shape.fullLeaves > 0) {
+        largePart = shape.fullCount;
+        leafParamter = shape.fullLeaves * ParameterCalculator::getInstance().at(shape.fullCount);
+    }
+    // the tail leaf is classified in the same way as any leaf which can store the remaining rules
+    if (shape.tailLeaf > 0) {
+        if (shape.tailLeaf < largeCount) {
+            smallPart = shape.tailLeaf;
+            smallCount++;
+        } else {
+            largePart = shape.tailLeaf;
+            largeCount++;
+        }
+        leafParamter += ParameterCalculator::getInstance().at(shape.tailLeaf);
+    }
+    leafCount = shape.fullLeaves + (shape.tailLeaf > 0 ? 1 : 0);
+    internalCount = shape.fullInternals + shape.tailInternals;
+    uint64_t depths = depthSum(shape.fullLeaves, h);
+    for (uint32_t i = 0; i <= shape.tailInternals && shape.tailLeaf > 0; i++) {
+        depths += shape.tailDepth + i;
+    }
+    internalParameter = depths;
     if (leafCount == 0                       || // the node count is too small for a h-height trie
-        n != 0                               || // the node count is too large for a h-height trie
         leafParamter + internalParameter < p || // the max parameter cannot reach p
         internalParameter > p) {                // the min parameter is too large
         return false;
     }
-    arrangePartitions(sumOfCount, p);
+    nodeCount = leafCount + static_cast<uint64_t>(internalCount);
+    arrangePartitions(n, p);
     return true;
 }
 
-uint32_t DensePartitionTrie::buildTrieNode(std::shared_ptr<TrieNode>& node, uint32_t& n, uint32_t h, uint32_t depth, double log2N) {
-    if (n == 0) { // there is no remaining rule to be allocated
-        return 0;
+bool DensePartitionTrie::exportOrigins(uint32_t n, uint32_t p, UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>> &origins) {
+    if (nodeCount == 0) {
+        origins.push(std::make_unique<ProblemState>(n, p, true, std::make_unique<UDRule>()));
+        return true;
     }
-    if (depth == h || n == 1) { // build a leaf node
-        leafCount++;
-        if (std::log2(n) <= log2N) { // can be stored within a single node
-            node = std::make_shared<TrieNode>(n);
-            if (n < largeCount) {
-                smallPart = n;
-                smallCount++;
-            } else {
-                largePart = n;
-                largeCount++;
+    bool noError = true;
+    leafIndex = 0;
+    std::vector<Frame> stack;
+    stack.push_back(Frame{0, 0, 0, std::make_unique<UDRule>(), nullptr});
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.stage == 0 && isLeaf(frame.rank, frame.depth)) {
+            exportLeaf(std::move(frame.rule), origins);
+            stack.pop_back();
+        } else if (frame.stage == 0) { // pre-order: rule split
+            frame.stage = 1;
+            auto pair = RuleSplitter::getInstance().split(*frame.rule);
+            frame.right = std::move(pair.second);
+            uint64_t child = frame.rank + 1;
+            uint32_t depth = frame.depth + 1;
+            if (child < nodeCount) {
+                if (pair.first != nullptr) {
+                    stack.push_back(Frame{child, depth, 0, std::move(pair.first), nullptr});
+                } else {
+                    noError = false;
+                }
             }
-            n = 0;
-        } else { // need to be split into multiple nodes, put N rules in the current node
-            uint32_t count = std::round(std::exp2(log2N));
-            node = std::make_shared<TrieNode>(count);
-            n -= count;
-            largePart = count;
-            largeCount++;
+        } else if (frame.stage == 1) {
+            frame.stage = 2;
+            uint64_t child = rightChildOf(frame.rank, frame.depth);
+            uint32_t depth = frame.depth + 1;
+            if (child < nodeCount) {
+                if (frame.right != nullptr) {
+                    stack.push_back(Frame{child, depth, 0, std::move(frame.right), nullptr});
+                } else {
+                    noError = false;
+                }
+            }
+        } else { // post-order: export the solid rule
+            finalSet.push_back(std::move(frame.rule));
+            stack.pop_back();
         }
-        node->isLeaf = true;
-        leafParamter += ParameterCalculator::getInstance().at(node->count);
-        return 1;
-    } else { // build an internal node
-        node = std::make_shared<TrieNode>(1); // the count of an internal node is 1
-        internalCount++;
-        n--;
-        uint32_t left = buildTrieNode(node->children[0], n, h, depth + 1, log2N);
-        uint32_t right = buildTrieNode(node->children[1], n, h, depth + 1, log2N);
-        internalParameter += left + right;
-        return left + right + 1;
     }
+    return noError;
 }
 
-
-void DensePartitionTrie::exportOrigins(std::shared_ptr<TrieNode> node, std::unique_ptr<UDRule> rule, UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>> &origins) {
-    if (node->isLeaf) {
-        uint32_t parameter = 0;
-        uint32_t part = 0;
-        if (leafIndex < fullLargeCount) {
-            parameter = fullLargeParameter;
-            part = largePart;
-        } else if (leafIndex < fullLargeCount + fullSmallCount) {
-            parameter = fullSmallParameter;
-            part = largePart;
-        } else {
-            parameter = partialParameter;
-            part = smallPart;
-        }
-        leafIndex++;
-        origins.push(std::make_unique<ProblemState>(part, parameter, true, std::move(rule)));
+void DensePartitionTrie::exportLeaf(std::unique_ptr<UDRule> rule, std::queue<std::unique_ptr<ProblemState>> &origins) {
+    uint32_t parameter = 0;
+    uint32_t part = 0;
+    if (leafIndex < fullLargeCount) {
+        parameter = fullLargeParameter;
+        part = largePart;
+    } else if (leafIndex < fullLargeCount + fullSmallCount) {
+        parameter = fullSmallParameter;
+        part = largePart;
     } else {
-        auto pair = RuleSplitter::getInstance().split(*rule);
-        if (node->children[0] != nullptr) {
-            if (pair.first != nullptr) {
-                exportOrigins(node->children[0], std::move(pair.first), finalSet, origins);
-            } else {
-                exportNoError = false;
-            }
-        }
-        if (node->children[1] != nullptr) {
-            if (pair.second != nullptr) {
-                exportOrigins(node->children[1], std::move(pair.second), finalSet, origins);
-            } else {
-                exportNoError = false;
-            }
-        }
-        finalSet.push_back(std::move(rule));
+        parameter = partialParameter;
+        part = smallPart;
     }
+    leafIndex++;
+    origins.push(std::make_unique<ProblemState>(part, parameter, true, std::move(rule)));
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+#pragma once
+
+// the pcap output of the trace (for trace generator, --pcap)
+// the data-plane benchmarks replay packets from pcap files, so the flows of the trace are written as real packets
+// the fields of the pre-defined protocols are mapped to the headers of the packets
+// 1. IPv4 / IPv6: Ethernet, IPv4 / IPv6 (src, dst, protocol), TCP / UDP (src port, dst port)
+// 2. OpenFlow 1.0: Ethernet (dl_src, dl_dst, dl_type), 802.1Q (dl_vlan, dl_vlan_pcp) if dl_vlan is not 0xffff,
+//    then IPv4 (nw_tos, nw_proto, nw_src, nw_dst) and TCP / UDP (tp_src, tp_dst) if dl_type is 0x0800,
+//    or ARP (nw_proto as the opcode, nw_src, nw_dst) if dl_type is 0x0806
+//    in_port is not a part of the packet, and the bits which do not fit the headers are dropped
+// for an IP protocol other than TCP and UDP, the ports are written in the first 4 bytes after the IP header
+// the checksums of IPv4, TCP and UDP are valid, and the frames are padded to the minimum Ethernet frame size
+// the packets are stamped by the rate model in nanoseconds (see rate_model.hpp)
+// the records are formatted into a large buffer, which is written at once when it is full
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "trace.hpp"
+
+namespace flowbench {
+
+class PcapWriter {
+private:
+    constexpr static uint32_t MAGIC = 0xa1b23c4d; // nanosecond timestamps, native byte order
+    constexpr static uint32_t SNAP_LENGTH = 65535;
+    constexpr static uint32_t LINK_TYPE_ETHERNET = 1;
+    constexpr static uint32_t RECORD_HEADER_SIZE = 16;
+    constexpr static uint32_t MIN_FRAME_SIZE = 60; // without FCS
+    constexpr static uint32_t MAX_FRAME_SIZE = 128;
+    constexpr static uint32_t BUFFER_SIZE = 1 << 20;
+
+    constexpr static uint8_t PROTOCOL_TCP = 6;
+    constexpr static uint8_t PROTOCOL_UDP = 17;
+    constexpr static uint16_t ETHER_TYPE_IPV4 = 0x0800;
+    constexpr static uint16_t ETHER_TYPE_ARP = 0x0806;
+    constexpr static uint16_t ETHER_TYPE_VLAN = 0x8100;
+    constexpr static uint16_t ETHER_TYPE_IPV6 = 0x86dd;
+    constexpr static uint16_t NO_VLAN = 0xffff; // dl_vlan of the packets without 802.1Q tag (OpenFlow 1.0)
+
+    const Trace& trace;
+    Protocol protocol;
+
+    static void put16(uint8_t* bytes, uint16_t value) {
+        bytes[0] = value >> 8;
+        bytes[1] = value;
+    }
+
+    static uint16_t get16(const uint8_t* bytes) {
+        return bytes[0] << 8 | bytes[1];
+    }
+
+    // the ones' complement sum of 16-bit words (not folded), size is even
+    static uint32_t sum(const uint8_t* bytes, uint32_t size, uint32_t result = 0) {
+        for (uint32_t i = 0; i < size; i += 2) {
+            result += get16(bytes + i);
+        }
+        return result;
+    }
+
+    static uint16_t checksum(uint32_t sum) {
+        while (sum >> 16) {
+            sum = (sum & 0xffff) + (sum >> 16);
+        }
+        return ~sum;
+    }
+
+    static uint8_t* writeMac(uint8_t* frame, const uint8_t* dst, const uint8_t* src, uint16_t etherType);
+
+    // the headers after the IP header, pseudoSum is the sum of the pseudo-header without the length
+    static uint32_t getTransportSize(uint8_t protocol) {
+        return protocol == PROTOCOL_TCP ? 20 : 8;
+    }
+    static uint8_t* writeTransport(uint8_t* frame, uint8_t protocol, const uint8_t* ports, uint32_t pseudoSum);
+
+    // the headers from the IP header, ports: src port and dst port (4 bytes)
+    static uint8_t* writeIPv4(uint8_t* frame, uint8_t tos, uint8_t protocol, const uint8_t* src, const uint8_t* dst,
+                              const uint8_t* ports);
+    static uint8_t* writeIPv6(uint8_t* frame, uint8_t protocol, const uint8_t* src, const uint8_t* dst, const uint8_t* ports);
+    static uint8_t* writeArp(uint8_t* frame, uint8_t operation, const uint8_t* mac, const uint8_t* src, const uint8_t* dst);
+
+    // write the frame of the flow, return its size
+    uint32_t writeFrame(uint32_t flowId, uint8_t* frame) const;
+
+public:
+    // the protocol of the trace should be a pre-defined protocol (see RuleTypeUD::getProtocol)
+    explicit PcapWriter(const Trace& trace) : trace(trace), protocol(RuleTypeUD::getInstance().getProtocol()) {}
+
+    // write the packets in [begin, end) as a pcap file
+    void write(std::ostream& os, uint32_t begin, uint32_t end) const;
+};
+
+constexpr uint32_t PcapWriter::MAGIC;
+constexpr uint32_t PcapWriter::SNAP_LENGTH;
+constexpr uint32_t PcapWriter::LINK_TYPE_ETHERNET;
+constexpr uint32_t PcapWriter::RECORD_HEADER_SIZE;
+constexpr uint32_t PcapWriter::MIN_FRAME_SIZE;
+constexpr uint32_t PcapWriter::MAX_FRAME_SIZE;
+constexpr uint32_t PcapWriter::BUFFER_SIZE;
+
+uint8_t* PcapWriter::writeMac(uint8_t* frame, const uint8_t* dst, const uint8_t* src, uint16_t etherType) {
+    memcpy(frame, dst, 6);
+    memcpy(frame + 6, src, 6);
+    put16(frame + 12, etherType);
+    return frame + 14;
+}
+
+uint8_t* PcapWriter::writeTransport(uint8_t* frame, uint8_t protocol, const uint8_t* ports, uint32_t pseudoSum) {
+    uint32_t size = getTransportSize(protocol);
+    memset(frame, 0, size);
+    memcpy(frame, ports, 4);
+    if (protocol == PROTOCOL_TCP) {
+        frame[12] = 0x50; // data offset: 5 words
+        frame[13] = 0x10; // ACK
+        put16(frame + 14, 0xffff); // window
+        put16(frame + 16, checksum(sum(frame, size, pseudoSum + size)));
+    } else if (protocol == PROTOCOL_UDP) {
+        put16(frame + 4, size);
+        uint16_t value = checksum(sum(frame, size, pseudoSum + size));
+        put16(frame + 6, value == 0 ? 0xffff : value);
+    }
+    return frame + size;
+}
+
+uint8_t* PcapWriter::writeIPv4(uint8_t* frame, uint8_t tos, uint8_t protocol, const uint8_t* src, const uint8_t* dst,
+                               const uint8_t* ports) {
+    frame[0] = 0x45; // version 4, 5 words
+    frame[1] = tos;
+    put16(frame + 2, 20 + getTransportSize(protocol));
+    put16(frame + 4, 0); // identification
+    put16(frame + 6, 0x4000); // don't fragment
+    frame[8] = 64; // TTL
+    frame[9] = protocol;
+    put16(frame + 10, 0);
+    memcpy(frame + 12, src, 4);
+    memcpy(frame + 16, dst, 4);
+    put16(frame + 10, checksum(sum(frame, 20)));
+    return writeTransport(frame + 20, protocol, ports, sum(frame + 12, 8, protocol));
+}
+
+uint8_t* PcapWriter::writeIPv6(uint8_t* frame, uint8_t protocol, const uint8_t* src, const uint8_t* dst, const uint8_t* ports) {
+    memset(frame, 0, 4);
+    frame[0] = 0x60; // version 6
+    put16(frame + 4, getTransportSize(protocol));
+    frame[6] = protocol;
+    frame[7] = 64; // hop limit
+    memcpy(frame + 8, src, 16);
+    memcpy(frame + 24, dst, 16);
+    return writeTransport(frame + 40, protocol, ports, sum(frame + 8, 32, protocol));
+}
+
+uint8_t* PcapWriter::writeArp(uint8_t* frame, uint8_t operation, const uint8_t* mac, const uint8_t* src, const uint8_t* dst) {
+    put16(frame, 1); // Ethernet
+    put16(frame + 2, ETHER_TYPE_IPV4);
+    frame[4] = 6;
+    frame[5] = 4;
+    put16(frame + 6, operation);
+    memcpy(frame + 8, mac, 6);
+    memcpy(frame + 14, src, 4);
+    memset(frame + 18, 0, 6);
+    memcpy(frame + 24, dst, 4);
+    return frame + 28;
+}
+
+uint32_t PcapWriter::writeFrame(uint32_t flowId, uint8_t* frame) const {
+    // locally administered addresses for the protocols without MAC fields
+    static const uint8_t srcMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    static const uint8_t dstMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    uint8_t ports[4];
+    uint8_t* end = frame;
+    switch (protocol) {
+        case Protocol::IPv4:
+            memcpy(ports, trace.getField(flowId, 2), 2);
+            memcpy(ports + 2, trace.getField(flowId, 3), 2);
+            end = writeMac(end, dstMac, srcMac, ETHER_TYPE_IPV4);
+            end = writeIPv4(end, 0, *trace.getField(flowId, 4), trace.getField(flowId, 0), trace.getField(flowId, 1), ports);
+            break;
+        case Protocol::IPv6:
+            memcpy(ports, trace.getField(flowId, 2), 2);
+            memcpy(ports + 2, trace.getField(flowId, 3), 2);
+            end = writeMac(end, dstMac, srcMac, ETHER_TYPE_IPV6);
+            end = writeIPv6(end, *trace.getField(flowId, 4), trace.getField(flowId, 0), trace.getField(flowId, 1), ports);
+            break;
+        case Protocol::OpenFlow1_0: {
+            uint16_t vlan = get16(trace.getField(flowId, 3));
+            uint16_t etherType = get16(trace.getField(flowId, 5));
+            if (vlan != NO_VLAN) {
+                end = writeMac(end, trace.getField(flowId, 2), trace.getField(flowId, 1), ETHER_TYPE_VLAN);
+                put16(end, (*trace.getField(flowId, 4) & 0x7) << 13 | (vlan & 0xfff));
+                put16(end + 2, etherType);
+                end += 4;
+            } else {
+                end = writeMac(end, trace.getField(flowId, 2), trace.getField(flowId, 1), etherType);
+            }
+            if (etherType == ETHER_TYPE_IPV4) {
+                memcpy(ports, trace.getField(flowId, 10), 2);
+                memcpy(ports + 2, trace.getField(flowId, 11), 2);
+                end = writeIPv4(end, *trace.getField(flowId, 6), *trace.getField(flowId, 7),
+                                trace.getField(flowId, 8), trace.getField(flowId, 9), ports);
+            } else if (etherType == ETHER_TYPE_ARP) {
+                end = writeArp(end, *trace.getField(flowId, 7), trace.getField(flowId, 1),
+                               trace.getField(flowId, 8), trace.getField(flowId, 9));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    uint32_t size = end - frame;
+    if (size < MIN_FRAME_SIZE) { // Ethernet padding
+        memset(end, 0, MIN_FRAME_SIZE - size);
+        size = MIN_FRAME_SIZE;
+    }
+    return size;
+}
+
+void PcapWriter::write(std::ostream& os, uint32_t begin, uint32_t end) const {
+    std::vector<uint8_t> buffer(BUFFER_SIZE);
+    uint8_t* last = buffer.data();
+    auto put32 = [&last](uint32_t value) {
+        memcpy(last, &value, sizeof(value));
+        last += sizeof(value);
+    };
+    put32(MAGIC);
+    put32(2 | 4 << 16); // version 2.4 (major and minor are 16 bits each)
+    put32(0); // time zone
+    put32(0); // accuracy of the timestamps
+    put32(SNAP_LENGTH);
+    put32(LINK_TYPE_ETHERNET);
+    trace.visitTimedPackets(begin, end, [&](uint32_t, uint32_t flowId, uint64_t timestamp) {
+        if (last + RECORD_HEADER_SIZE + MAX_FRAME_SIZE > buffer.data() + buffer.size()) {
+            os.write(reinterpret_cast<const char*>(buffer.data()), last - buffer.data());
+            last = buffer.data();
+        }
+        uint32_t size = writeFrame(flowId, last + RECORD_HEADER_SIZE);
+        put32(timestamp / 1000000000);
+        put32(timestamp % 1000000000);
+        put32(size);
+        put32(size);
+        last += size;
+    });
+    os.write(reinterpret_cast<const char*>(buffer.data()), last - buffer.data());
+}
+
+}
\ No newline at end of file
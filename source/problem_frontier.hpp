@@ -0,0 +1,72 @@
+#pragma once
+
+// the frontier of the recursive tree
+// i.e. the problem states which have been generated but not solved
+
+// by default, the states are solved layer by layer (breadth-first)
+// however, the widest layer may hold about n/4 states, each with a cloned parent rule
+// which is the peak memory of a large rule set, even more than the output
+// so we also support a depth-first order (--dfs)
+// the children of a state are solved before its siblings, in the same order as they are generated
+// so there are at most 4 states per layer in the frontier, i.e. O(4 * depth) states in total
+// NOTE: both orders are deterministic for a given random seed
+//       but the random choices are made in different orders, so the generated rule sets are different
+
+#include <algorithm>
+#include <deque>
+
+#include "problem_state.hpp"
+
+namespace flowbench {
+
+class ProblemFrontier {
+private:
+    std::deque<std::unique_ptr<ProblemState>> states;
+
+    // whether the states are solved in the depth-first order
+    bool depthFirst;
+
+    // the states after this position are pushed after the last pop (depth-first only)
+    // they are the children of the last state, which should be popped in the pushed order
+    size_t newStart = 0;
+
+public:
+    explicit ProblemFrontier(bool depthFirst = false) : depthFirst(depthFirst) {}
+
+    bool empty() const {
+        return states.empty();
+    }
+
+    size_t size() const {
+        return states.size();
+    }
+
+    void clear() {
+        states.clear();
+        newStart = 0;
+    }
+
+    void push(std::unique_ptr<ProblemState> state) {
+        states.push_back(std::move(state));
+    }
+
+    // take the next state to solve
+    std::unique_ptr<ProblemState> pop();
+};
+
+std::unique_ptr<ProblemState> ProblemFrontier::pop() {
+    std::unique_ptr<ProblemState> state;
+    if (depthFirst) {
+        // the frontier is a stack, reverse the new children so that the first child is on the top
+        std::reverse(states.begin() + newStart, states.end());
+        state = std::move(states.back());
+        states.pop_back();
+        newStart = states.size();
+    } else {
+        state = std::move(states.front());
+        states.pop_front();
+    }
+    return state;
+}
+
+}
\ No newline at end of file
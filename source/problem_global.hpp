@@ -14,14 +14,14 @@ class GlobalProblem {
 private:
     // the origins of the sub-problems
     std::queue<std::unique_ptr<ProblemState>> subProblems;
-    // the state queue in a sub-problem
-    std::queue<std::unique_ptr<ProblemState>> stateQueue;
+    // the unsolved states in a sub-problem
+    ProblemFrontier frontier;
     UDRuleSet finalSet;
     double time;
     bool solved = false;
 
 public:
-    GlobalProblem() = default;
+    GlobalProblem() : frontier(Configuration::getInstance().isEnableDepthFirst()) {}
 
     // solve the global problem
     // default: start from wildcard, if failed:
@@ -39,9 +39,7 @@ private:
         while (!subProblems.empty()) {
             subProblems.pop();
         }
-        while (!stateQueue.empty()) {
-            stateQueue.pop();
-        }
+        frontier.clear();
         finalSet.clear();
     }
 
@@ -81,19 +79,15 @@ bool GlobalProblem::solveSubProblem() {
     auto subProblem = std::move(subProblems.front());
     subProblems.pop();
     bool success = true;
-    while (!stateQueue.empty()) {
-        stateQueue.pop();
-    }
+    frontier.clear();
     time += reportTime([&]() {
-        stateQueue.push(std::move(subProblem));
-        while (!stateQueue.empty()) {
-            auto state = std::move(stateQueue.front());
-            stateQueue.pop();
-            if (!LocalProblem::getInstance().solve(std::move(state))) {
+        frontier.push(std::move(subProblem));
+        while (!frontier.empty()) {
+            if (!LocalProblem::getInstance().solve(frontier.pop())) {
                 success = false;
                 break;
             } else {
-                LocalProblem::getInstance().exportRules(finalSet, stateQueue);
+                LocalProblem::getInstance().exportRules(finalSet, frontier);
             }
         }
     });
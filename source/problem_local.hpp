@@ -7,20 +7,17 @@
 // 4. apply xor operation to the rule set
 // 5. convert the candidate rule set to a user-defined rule set
 // 6. concatenate the parent virtual rule and the rules we have generated
-// 7. random perturb the RM fields (if enabled Arbitrary Range)
-// 8. generate new subproblems on the next layer (if required)
+// 7. choose arbitrary cut points for the RM fields (if enabled Arbitrary Range)
+// 8. generate new subproblems on the next layer (if required), which are pushed into the frontier
+// step 3 to 7 are fused (see instantiater_fused.hpp)
+// so that the rules are written to the final set or the next layer directly
 
-#include <queue>
-
-#include "problem_state.hpp"
+#include "problem_frontier.hpp"
 #include "divider_manager.hpp"
 #include "quad_dag_selector.hpp"
 #include "rule_virtual_selector.hpp"
 #include "rule_virtual_splitter.hpp"
-#include "instantiater_bit.hpp"
-#include "instantiater_field.hpp"
-#include "instantiater_rule.hpp"
-#include "random_perturbator.hpp"
+#include "instantiater_fused.hpp"
 
 namespace flowbench {
 
@@ -29,53 +26,55 @@ private:
     // the state of the local subproblem
     std::unique_ptr<ProblemState> state;
 
-    // the user-defined rule set generated by the local subproblem
-    std::unique_ptr<UDRuleSet> ruleSet;
-
     // for debug
     friend std::ostream& operator<<(std::ostream& os, const LocalProblem& problem);
 
 public:
     bool solve(std::unique_ptr<ProblemState> givenState);
-    void exportRules(UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>>& stateQueue);
+    void exportRules(UDRuleSet& finalSet, ProblemFrontier& frontier);
 
+private:
+    bool reportNoCandidate() const {
+        std::cerr << "    No candidate can be selected" << std::endl;
+        return false;
+    }
 };
 
 bool LocalProblem::solve(std::unique_ptr<ProblemState> givenState) {
     state = std::move(givenState);
-    try {
-        uint32_t quadDagIndex = QuadDagSelector::getInstance().select(*state);
-        const auto& profile = QuadDagPool::getInstance().getProfile(quadDagIndex);
-        if (state->n > QD_VERTEX_CNT) {
-            VirtualRuleSelector::getInstance().select(*state, profile);
-        }
-        auto candidateRuleSet = VirtualRuleSplitter::getInstance().split(*state, profile);
-        BitInstantiater::getInstance()(*candidateRuleSet);
-        ruleSet = FieldInstantiater::getInstance()(*candidateRuleSet, *state, profile);
-        RuleInstantiater::getInstance()(*ruleSet, *(state->parent));
-        RandomPerturbator::getInstance()(*ruleSet, *(state->parent));
-    } catch (const NoCandidateError& e) {
-        std::cerr << "    " << e.what() << std::endl;
-        return false;
+    // failing to select a candidate is a normal result of the search (the caller will try another partition)
+    // so every step reports it by its return value
+    uint32_t quadDagIndex = QuadDagSelector::getInstance().select(*state);
+    if (quadDagIndex == NO_CANDIDATE) {
+        return reportNoCandidate();
+    }
+    const auto& profile = QuadDagPool::getInstance().getProfile(quadDagIndex);
+    if (state->n > QD_VERTEX_CNT && !VirtualRuleSelector::getInstance().select(*state, profile)) {
+        return reportNoCandidate();
+    }
+    if (!FusedInstantiater::getInstance().prepare(*state, profile)) {
+        return reportNoCandidate();
     }
     return true;
 }
 
-void LocalProblem::exportRules(UDRuleSet& finalSet, std::queue<std::unique_ptr<ProblemState>>& stateQueue) {
+void LocalProblem::exportRules(UDRuleSet& finalSet, ProblemFrontier& frontier) {
+    const auto& instantiater = FusedInstantiater::getInstance();
     for (uint8_t i = 0; i < std::min<uint32_t>(QD_VERTEX_CNT, state->n); i++) {
-        finalSet.push_back(std::move(ruleSet->at(i)));
+        finalSet.push_back(instantiater.instantiate(i, *(state->parent)));
     }
     if (state->n > QD_VERTEX_CNT) {
         // Divider divider(state->n - QD_VERTEX_CNT);
         const auto& divider = DividerManager::getInstance().getDivider(state->n - QD_VERTEX_CNT);
-        for (uint8_t i = QD_VERTEX_CNT; i < ruleSet->size(); i++) {
+        uint32_t count = QD_VERTEX_CNT + virtualRuleIndexes.size();
+        for (uint8_t i = QD_VERTEX_CNT; i < count; i++) {
             uint32_t childN = divider.result[i - QD_VERTEX_CNT];
             if (childN > 0) {
-                stateQueue.push(std::make_unique<ProblemState>(
+                frontier.push(std::make_unique<ProblemState>(
                     childN,
                     VirtualRuleSelector::getInstance().parameters[i - QD_VERTEX_CNT],
                     VirtualRuleSplitter::getInstance().allowWildcard[i - QD_VERTEX_CNT],
-                    std::move(ruleSet->at(i))
+                    instantiater.instantiate(i, *(state->parent))
                 ));
             }
         }
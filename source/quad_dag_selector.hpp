@@ -15,6 +15,8 @@ namespace flowbench {
 class QuadDagSelector : public Singleton<QuadDagSelector> {
 public:
     QuadDagSelector() = default;
+
+    // return NO_CANDIDATE if no QuadDag satisfies the state
     uint32_t select(const ProblemState& state) const;
 };
 
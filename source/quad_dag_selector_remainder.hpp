@@ -8,7 +8,6 @@
 #include "problem_state.hpp"
 #include "quad_dag_pool.hpp"
 #include "random.hpp"
-#include "exception.hpp"
 
 namespace flowbench {
 
@@ -24,6 +23,7 @@ private:
 
 public:
     RemainderQuadDagSelector();
+    // return NO_CANDIDATE if no QuadDag satisfies the state
     uint32_t select(const ProblemState& state) const;
 };
 
@@ -49,7 +49,7 @@ uint32_t RemainderQuadDagSelector::select(const ProblemState& state) const {
     const auto& table = state.allowWildcard ? lut : lutnw;
     const auto& candidates = table[n-1][k-1][p];
     if (candidates.empty()) {
-        throw NoCandidateError();
+        return NO_CANDIDATE;
     }
     auto index = Random::getInstance().nextInt32(0, candidates.size() - 1);
     return candidates[index];
@@ -5,7 +5,6 @@
 // which means we select a QuadDag whose 4 solid rules are all in the result set
 // and we select some of the virtual rules as the parents of the next layer's search
 
-#include "exception.hpp"
 #include "divider_manager.hpp"
 #include "normal_distribution.hpp"
 #include "random_selector.hpp"
@@ -41,6 +40,8 @@ private:
 
 public:
     UnionQuadDagSelector();
+
+    // return NO_CANDIDATE if no QuadDag satisfies the state
     uint32_t select(const ProblemState& state);
 };
 
@@ -98,6 +99,9 @@ uint32_t UnionQuadDagSelector::select(const ProblemState& state) {
         }
     }
     uint32_t p1 = RandomSelector::getInstance().select(weights);
+    if (p1 == NO_CANDIDATE) {
+        return NO_CANDIDATE;
+    }
     const auto& table = *tables[p1];
     uint32_t index = Random::getInstance().nextInt32(0, table.size() - 1);
     return table[index];
@@ -11,7 +11,7 @@
 
 namespace flowbench {
 
-class Random : public Singleton<Random> {
+class Random : public ThreadLocalSingleton<Random> {
 public:
     Random() = default;
     Random(uint32_t seed) {
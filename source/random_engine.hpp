@@ -1,6 +1,7 @@
 #pragma once
 
 // define a MT19337 random engine
+// every thread has its own engine, so the jobs running concurrently do not share the random state
 
 #include <cstdint>
 
@@ -8,7 +9,7 @@
 
 namespace flowbench {
 
-class RandomEngine : public Singleton<RandomEngine> {
+class RandomEngine : public ThreadLocalSingleton<RandomEngine> {
 private:
     constexpr uint32_t temper(uint32_t y) const {
         y ^= y >> 11;
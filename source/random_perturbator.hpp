@@ -7,66 +7,102 @@
 // in the fourth step (Bit instantiater), we have applied xor operation to the rule set
 // in the fifth step (Field instantiater), we have converted the candidate rule set to a user-defined rule set
 // in the sixth step (Rule instantiater), we have concatenated the parent virtual rule and the rules we have generated
-// after the steps above, we have generated a mixed rule set of User-Defined rules
-//                        which can be used to generate a final rule set
 // if the user enable Arbitrary Range, FlowBench will add this step to the procedure
-// in this step, we will randomly apply a perturbation to the RM fields
+// in this step, we will choose arbitrary (non-prefix) cut points for the RM fields
 //               so that we can get more diverse rule sets
-// this step will harm the performance of the algorithm (about 3x)
-// and in some cases (e.g. TCAM) arbitrary range will not be supported by the hardware
+// the RM fields of a subproblem are converted from prefixes of at most k bits (k = the required width)
+// so every start and every end + 1 is a boundary of the 2^k uniform cells of the parent range
+// instead of placing the boundaries uniformly (which produces prefix-aligned ranges)
+// we randomly move every inner boundary inside its own neighborhood, keeping the boundaries strictly increasing
+// since the same monotone mapping is applied to all rules of the subproblem
+// the relationships (overlap, cover, equal) between the sibling rules are kept by construction
+// e.g. 4 cells of [0, 15]: boundaries 0, 4, 8, 12, 16 -> 0, 3, 9, 11, 16
+//      [0, 7] -> [0, 8], [8, 15] -> [9, 15], [4, 11] -> [3, 10]
+// and no verification or retry is needed (the cost is O(2^k) per RM field per subproblem)
+// in some cases (e.g. TCAM) arbitrary range will not be supported by the hardware
 // so we recommend the user to disable this step if not necessary
 
 #include "configuration.hpp"
-#include "rule_set.hpp"
+#include "instantiater_field.hpp"
 #include "random.hpp"
 
 namespace flowbench {
 
 class RandomPerturbator : public Singleton<RandomPerturbator> {
+private:
+    // whether the cut points of the field are prepared (RM fields only, with Arbitrary Range enabled)
+    std::vector<bool> prepared;
+
+    // the bit width k of the cells of each field
+    std::vector<uint8_t> cellBits;
+
+    // the 2^k+1 absolute boundaries of the cells of each field
+    std::vector<std::vector<uint64_t>> boundaries;
+
 public:
     RandomPerturbator() = default;
-    void operator()(UDRuleSet& ruleSet, const UDRule& parent) const;
+
+    // choose the cut points of the RM fields for the current subproblem
+    // should be called after the field mapping is generated
+    // parent: the parent rule of the current subproblem
+    void prepare(const UDRule& parent);
+
+    bool isPrepared(uint8_t fieldIndex) const {
+        return fieldIndex < prepared.size() && prepared[fieldIndex];
+    }
+
+    uint8_t getCellBits(uint8_t fieldIndex) const {
+        return cellBits[fieldIndex];
+    }
+
+    const std::vector<uint64_t>& getBoundaries(uint8_t fieldIndex) const {
+        return boundaries[fieldIndex];
+    }
 };
 
-void RandomPerturbator::operator()(UDRuleSet& ruleSet, const UDRule& parent) const {
-    if (Configuration::getInstance().isEnableArbitraryRange()) {
-        for (uint8_t i = 0; i < RuleTypeUD::getInstance().getFieldCount(); i++) {
-            if (RuleTypeUD::getInstance().getMatchType(i) == MatchType::RM) {
-                const auto& parentRm = parent.getFieldAs<RmField<Int32>>(i);
-                int64_t parentMin = parentRm.getMin().getValue();
-                int64_t parentMax = parentRm.getMax().getValue();
-                for (uint8_t j = 0; j < ruleSet.size(); j++) {
-                    auto& rule = ruleSet.getRule(j);
-                    auto newRule = rule.clone();
-                    auto& rm = rule.getFieldAs<RmField<Int32>>(i);
-                    int64_t min = rm.getMin().getValue();
-                    int64_t max = rm.getMax().getValue();
-                    int64_t range = max - min + 1;
-                    for (int64_t r = range / 4; r > 0; r /= 2) {
-                        int64_t offsetMin = Random::getInstance().nextInt32(-r, r);
-                        int64_t offsetMax = Random::getInstance().nextInt32(-r, r);
-                        uint32_t newMin = std::max(min + offsetMin, parentMin);
-                        uint32_t newMax = std::min(max + offsetMax, parentMax);
-                        newRule->setField(i, std::make_unique<RmField<Int32>>(newMin, newMax));
-                        bool isValid = true;
-                        for (uint8_t k = 0; k < ruleSet.size(); k++) {
-                            if (k == j) {
-                                continue;
-                            }
-                            const auto& otherRule = ruleSet.getRule(k);
-                            if (otherRule.overlap(rule) != otherRule.overlap(*newRule)) {
-                                isValid = false;
-                                break;
-                            }
-                        }
-                        if (isValid) {
-                            ruleSet.at(j) = std::move(newRule);
-                            break;
-                        }
-                    }
-                }
-            }
+void RandomPerturbator::prepare(const UDRule& parent) {
+    uint8_t fieldCount = RuleTypeUD::getInstance().getFieldCount();
+    prepared.assign(fieldCount, false);
+    if (!Configuration::getInstance().isEnableArbitraryRange()) {
+        return;
+    }
+    cellBits.resize(fieldCount);
+    boundaries.resize(fieldCount);
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        if (RuleTypeUD::getInstance().getMatchType(i) != MatchType::RM) {
+            continue;
+        }
+        // the boundaries are chosen in units of the field width
+        // otherwise two different boundaries may be printed as the same value
+        uint8_t shift = 32 - RuleTypeUD::getInstance().getFieldWidth(i);
+        const auto& parentRm = parent.getFieldAs<RmField<Int32>>(i);
+        uint64_t parentMin = parentRm.getMin().getValue() >> shift;
+        uint64_t range = (parentRm.getMax().getValue() >> shift) - parentMin + 1;
+        uint8_t bits = FieldInstantiater::getInstance().getRequiredWidth(i);
+        if ((range >> bits) == 0) { // the parent is too narrow, keep the uniform cells
+            continue;
+        }
+        uint64_t cellCount = 1ull << bits;
+        auto uniform = [range, bits](uint64_t j) {
+            return j * range >> bits;
+        };
+        auto& cuts = boundaries[i];
+        cuts.resize(cellCount + 1);
+        cuts[0] = 0;
+        cuts[cellCount] = range;
+        // the j-th boundary is moved within (mid(j-1, j), mid(j, j+1)]
+        // where mid(a, b) is the midpoint of the a-th and b-th uniform boundaries
+        // the neighborhoods are disjoint and non-empty (a cell has at least 1 unit), so the boundaries are strictly increasing
+        for (uint64_t j = 1; j < cellCount; j++) {
+            uint64_t low = (uniform(j - 1) + uniform(j)) / 2;
+            uint64_t high = (uniform(j) + uniform(j + 1)) / 2;
+            cuts[j] = low + 1 + Random::getInstance().nextUInt32(0, high - low - 1);
+        }
+        for (auto& cut : cuts) {
+            cut = (parentMin + cut) << shift;
         }
+        cellBits[i] = bits;
+        prepared[i] = true;
     }
 }
 
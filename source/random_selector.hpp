@@ -2,11 +2,13 @@
 
 // a random selector
 // select a random element from a container, vector or array
+// it is called in the hot path of the search, so a failed selection is not an exception
+// if no element can be selected (all weights are zero), NO_CANDIDATE is returned
 
 #include <numeric>
 
+#include "constants.hpp"
 #include "random.hpp"
-#include "exception.hpp"
 
 namespace flowbench {
 
@@ -15,14 +17,14 @@ public:
     RandomSelector() = default;
 
     template <typename T> // T is a container, vector or array
-    uint32_t select(T weights) const;
+    uint32_t select(const T& weights) const;
 };
 
 template <typename T>
-uint32_t RandomSelector::select(T weights) const {
+uint32_t RandomSelector::select(const T& weights) const {
     double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
     if (sum == 0) {
-        throw NoCandidateError();
+        return NO_CANDIDATE;
     }
     double r = Random::getInstance().nextDouble(0, sum);
     for (uint32_t i = 0; i < weights.size(); i++) {
@@ -0,0 +1,163 @@
+#pragma once
+
+// the timestamps of the packets (for trace generator, --rate), written in the binary trace and the pcap file
+// a classifier is benchmarked under load by replaying the packets at their timestamps, so the arrival process matters
+// we provide four models, the rate is in packets per second and the times are in microseconds
+// 1. constant:R, a packet every 1 / R seconds (the default is constant:1e6)
+// 2. poisson:R, Poisson arrivals, the gaps are exponential with mean 1 / R
+// 3. onoff:R:ON:OFF, on/off bursts, the packets are 1 / R apart during the on periods,
+//    and the on and off periods are exponential with mean ON and OFF
+// 4. train:R:GAP, packet trains, the consecutive packets of the same flow are a train and they are 1 / R apart,
+//    and a new train starts after an exponential gap with mean GAP
+//    the trains come from the order of the packets, so it is useful with --temporal or --churn
+// the timestamps are generated in a single pass over the packet sequence, with the random engine of the generator
+// so the timestamp of a packet does not depend on the other random draws, and a slice gets the same timestamps
+
+#include <cmath>
+#include <iostream>
+
+#include "enumrate.hpp"
+
+namespace flowbench {
+
+enum class RateModelType {
+    Unknown,
+    Constant,
+    Poisson,
+    OnOff,
+    Train
+};
+
+template <>
+const auto getNames<RateModelType>() {
+    static const std::unordered_map<RateModelType, const char*> names = {
+        {RateModelType::Constant, "constant"},
+        {RateModelType::Poisson, "poisson"},
+        {RateModelType::OnOff, "onoff"},
+        {RateModelType::Train, "train"}
+    };
+    return &names;
+}
+
+class RateModel {
+private:
+    RateModelType type = RateModelType::Constant;
+    double rate = 1e6;
+    double onTime = 0.0;
+    double offTime = 0.0; // also the gap between the trains
+
+public:
+    RateModel() = default;
+    RateModel(RateModelType type, double rate, double onTime = 0.0, double offTime = 0.0)
+        : type(type), rate(rate), onTime(onTime), offTime(offTime) {}
+
+    RateModelType getType() const {
+        return type;
+    }
+
+    double getRate() const {
+        return rate;
+    }
+
+    double getOnTime() const {
+        return onTime;
+    }
+
+    double getOffTime() const {
+        return offTime;
+    }
+
+    // whether the timestamp of a packet depends on the flows of the previous packets
+    bool dependsOnFlows() const {
+        return type == RateModelType::Train;
+    }
+
+    void print(std::ostream& os) const {
+        os << getEnumName(type) << "(" << rate;
+        if (type == RateModelType::OnOff) {
+            os << ", " << onTime << ", " << offTime;
+        } else if (type == RateModelType::Train) {
+            os << ", " << offTime;
+        }
+        os << ")";
+    }
+};
+
+// generate the timestamps of the packets one by one, in nanoseconds from the first packet
+class TimestampGenerator {
+private:
+    const RateModel& model;
+    uint64_t state;
+    uint64_t packetIndex = 0;
+    double interval; // nanoseconds
+    double time = 0.0;
+    double onEnd = 0.0;
+    uint32_t lastFlowId = UINT32_MAX;
+
+    // SplitMix64, uniform in (0, 1]
+    double nextUniform() {
+        uint64_t x = state += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return ((x >> 11) + 1) / 9007199254740992.0;
+    }
+
+    // exponential with the mean in microseconds, in nanoseconds
+    double nextExponential(double mean) {
+        return -std::log(nextUniform()) * mean * 1e3;
+    }
+
+public:
+    TimestampGenerator(const RateModel& model, uint32_t seed);
+
+    // the timestamp of the next packet, which belongs to the flow
+    uint64_t next(uint32_t flowId);
+
+    // skip the next count packets (only for the models which do not depend on the flows)
+    void skip(uint64_t count);
+};
+
+TimestampGenerator::TimestampGenerator(const RateModel& model, uint32_t seed)
+    : model(model), state(static_cast<uint64_t>(seed) << 32 | seed), interval(1e9 / model.getRate()) {
+    if (model.getType() == RateModelType::OnOff) {
+        onEnd = nextExponential(model.getOnTime());
+    }
+}
+
+uint64_t TimestampGenerator::next(uint32_t flowId) {
+    if (packetIndex++ > 0) {
+        switch (model.getType()) {
+        case RateModelType::Poisson:
+            time += nextExponential(1e6 / model.getRate());
+            break;
+        case RateModelType::OnOff:
+            time += interval;
+            while (time >= onEnd) { // the packet is in the next on period
+                time = onEnd + nextExponential(model.getOffTime());
+                onEnd = time + nextExponential(model.getOnTime());
+            }
+            break;
+        case RateModelType::Train:
+            time += interval + (flowId != lastFlowId ? nextExponential(model.getOffTime()) : 0.0);
+            break;
+        default:
+            time = (packetIndex - 1) * interval; // no accumulated rounding error
+            break;
+        }
+    }
+    lastFlowId = flowId;
+    return std::llround(time);
+}
+
+void TimestampGenerator::skip(uint64_t count) {
+    if (model.getType() == RateModelType::Constant || model.getType() == RateModelType::Unknown) {
+        packetIndex += count;
+        return;
+    }
+    for (uint64_t j = 0; j < count; j++) {
+        next(UINT32_MAX);
+    }
+}
+
+}
\ No newline at end of file
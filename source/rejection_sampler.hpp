@@ -0,0 +1,109 @@
+#pragma once
+
+// rejection sampling of flows (for rejection mode, --rejection)
+// instead of isolating the rule pool, we draw a flow inside rule i directly
+// and check it against the higher-priority (later) rules overlapping with rule i
+// 1. if none of them matches the flow, rule i is the first rule hit by the flow
+// 2. otherwise, we reject the flow and draw another one (at most MAX_ATTEMPTS times)
+//    the flows are drawn in the given part of rule i first (the flow of FlowEnumerator, to keep the flow-level locality),
+//    and then in the whole rule i
+// 3. if all the attempts are rejected (rule i is (almost) covered by the higher-priority rules),
+//    the flow is kept and labeled with the rule it actually hits first
+// so the rule index of every flow is exact, and the cost is O(traces * overlapping rules)
+// the overlapping rules are found by an overlap index of the rule pool (see rule_overlap_index.hpp)
+
+#include "flow.hpp"
+#include "flow_enumerator.hpp"
+#include "rule_pool.hpp"
+#include "rule_overlap_index.hpp"
+
+namespace flowbench {
+
+class RejectionSampler : public ThreadLocalSingleton<RejectionSampler> {
+private:
+    constexpr static uint32_t MAX_ATTEMPTS = 64;
+
+    // the index is read-only after being built, so it can be shared by the samplers of different threads
+    std::shared_ptr<const RuleOverlapIndex> index;
+
+    // the higher-priority rules overlapping with the rule of ruleIndex (cached for the last rule)
+    uint32_t ruleIndex = UINT32_MAX;
+    std::vector<uint32_t> higherRules;
+
+    // the number of flows relabeled after MAX_ATTEMPTS rejections
+    uint32_t relabeledCount = 0;
+
+    // the index of the rule hit by the flow first
+    // (the flow is assumed to hit the rule of ruleIndex)
+    uint32_t getFirstHit(const Flow& flow) const;
+
+public:
+    RejectionSampler() = default;
+
+    // draw the flowIndex-th flow of the enumerator, whose rule is the ruleIndex-th rule of the rule pool
+    std::unique_ptr<Flow> sample(const FlowEnumerator& enumerator, uint32_t flowIndex, uint32_t ruleIndex);
+
+    // the index of the rule hit by the flow first, the flow should hit the ruleIndex-th rule of the rule pool
+    // for the flows drawn in other ways (see overlap_sampler.hpp)
+    uint32_t getFirstHit(const Flow& flow, uint32_t ruleIndex);
+
+    // the overlap index of the rule pool (built on the first call)
+    const std::shared_ptr<const RuleOverlapIndex>& getIndex() {
+        if (index == nullptr) {
+            index = std::make_shared<RuleOverlapIndex>(RulePool::getInstance());
+        }
+        return index;
+    }
+
+    void setIndex(const std::shared_ptr<const RuleOverlapIndex>& index) {
+        this->index = index;
+    }
+
+    uint32_t getRelabeledCount() const {
+        return relabeledCount;
+    }
+
+    void addRelabeledCount(uint32_t count) {
+        relabeledCount += count;
+    }
+};
+
+uint32_t RejectionSampler::getFirstHit(const Flow& flow) const {
+    // the rules hit by the flow overlap with the rule of the flow, the last one has the highest priority
+    for (auto it = higherRules.rbegin(); it != higherRules.rend(); it++) {
+        if (flow.match(RulePool::getInstance().getRule(*it))) {
+            return *it;
+        }
+    }
+    return ruleIndex;
+}
+
+uint32_t RejectionSampler::getFirstHit(const Flow& flow, uint32_t ruleIndex) {
+    const auto& rulePool = RulePool::getInstance();
+    if (this->ruleIndex != ruleIndex) {
+        this->ruleIndex = ruleIndex;
+        getIndex()->query(rulePool.getRule(ruleIndex), ruleIndex + 1, rulePool.size(), higherRules);
+    }
+    return getFirstHit(flow);
+}
+
+std::unique_ptr<Flow> RejectionSampler::sample(const FlowEnumerator& enumerator, uint32_t flowIndex, uint32_t ruleIndex) {
+    const auto& poolRule = RulePool::getInstance().getRule(ruleIndex);
+    std::unique_ptr<Flow> flow;
+    uint32_t firstHit = UINT32_MAX;
+    for (uint32_t i = 0; i < MAX_ATTEMPTS && firstHit != ruleIndex; i++) {
+        if (i < MAX_ATTEMPTS / 2) {
+            flow = enumerator.getFlow(flowIndex, ruleIndex);
+        } else {
+            flow = std::make_unique<Flow>(poolRule, ruleIndex);
+        }
+        firstHit = getFirstHit(*flow, ruleIndex);
+    }
+    if (firstHit != ruleIndex) {
+        flow->setRuleIndex(firstHit);
+        relabeledCount++;
+    }
+    return flow;
+}
+
+}
\ No newline at end of file
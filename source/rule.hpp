@@ -47,6 +47,8 @@ private:
 public:
     bool overlap(const Rule& other) const;
     bool cover(const Rule& other) const;
+    // the rule matching the headers matched by both rules, or nullptr if they do not overlap
+    std::unique_ptr<Rule> intersect(const Rule& other) const;
     bool operator==(const Rule& other) const;
     EdgeType getEdgeTypeTo(const Rule& other) const;
 
@@ -108,6 +110,19 @@ bool Rule<T>::cover(const Rule& other) const {
     });
 }
 
+template <class T>
+std::unique_ptr<Rule<T>> Rule<T>::intersect(const Rule& other) const {
+    auto result = std::make_unique<Rule>();
+    for (uint8_t i = 0; i < getFieldCount(); i++) {
+        auto field = getField(i).intersect(other.getField(i));
+        if (field == nullptr) {
+            return nullptr;
+        }
+        result->setField(i, std::move(field));
+    }
+    return result;
+}
+
 template <class T>
 bool Rule<T>::operator==(const Rule& other) const {
     return compareFields(other, [](const MatchField& a, const MatchField& b) {
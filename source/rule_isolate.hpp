@@ -0,0 +1,132 @@
+#pragma once
+
+// isolate rule
+// for trace generator, we need to split the rules into isolate rules
+// a rule r is split by every later rule overlapping with it (the later rule has a higher priority)
+// when r is split by a rule:
+// 1. find the different fields between r and the rule
+// 2. calculate the difference of the different fields
+// 3. make a Cartesian product of the different fields
+// every piece is split by the next overlapping rule in the same way, and only the first piece is used
+// so we do not split the rule eagerly (the Cartesian products may explode on many-field protocols)
+// instead, an isolate rule is kept symbolically as the rule minus the subtracted rules
+// and the first piece is found by a depth-first search, where the Cartesian products are enumerated lazily
+// the first piece of every rule is materialized during the isolation, before Rule Mapping selects the rules
+// since the isolate rule set is sorted by the available widths of the first pieces, which Rule Mapping searches (see mapping_rule.hpp)
+// the other pieces are never used, so no volume or available width is computed for the rule minus the subtracted rules
+// note: the subtracted rules should overlap with the rule (see rule_overlap_index.hpp)
+
+#include "rule_set.hpp"
+
+namespace flowbench {
+
+class IsolateRule {
+private:
+    // the pieces of a rule split by another rule, in the order of the Cartesian product
+    class Split {
+    private:
+        std::unique_ptr<UDRule> rule;
+        std::vector<uint8_t> differentFields;
+        std::vector<std::vector<std::unique_ptr<MatchField>>> differentFieldValues;
+        std::vector<uint32_t> indexes;
+        bool exhausted = true;
+
+    public:
+        // the index of the next subtracted rule for the pieces
+        uint32_t next = 0;
+
+        // return false if there is no piece (the rule is covered, or the difference cannot be represented)
+        bool build(std::unique_ptr<UDRule> rule, const UDRule& other);
+
+        // return nullptr if all the pieces have been enumerated
+        std::unique_ptr<UDRule> nextPiece();
+    };
+
+    const UDRule& rule;
+    std::vector<const UDRule*> subtracted;
+
+public:
+    IsolateRule(const UDRule& rule) : rule(rule) {}
+
+    // subtract a later rule, which must overlap with the rule
+    void subtract(const UDRule& other) {
+        subtracted.push_back(&other);
+    }
+
+    // the first piece of the rule not overlapping with any subtracted rule
+    // return nullptr if there is no such piece
+    std::unique_ptr<UDRule> materialize() const;
+};
+
+bool IsolateRule::Split::build(std::unique_ptr<UDRule> rule, const UDRule& other) {
+    this->rule = std::move(rule);
+    exhausted = true;
+    differentFields.clear();
+    differentFieldValues.clear();
+    for (uint8_t j = 0; j < this->rule->getFieldCount(); j++) {
+        if (this->rule->getField(j) != other.getField(j)) {
+            differentFields.push_back(j);
+        }
+    }
+    if (differentFields.empty()) {
+        return false;
+    }
+    for (auto j : differentFields) {
+        std::vector<std::unique_ptr<MatchField>> values;
+        if (!this->rule->getField(j).difference(other.getField(j), values)) {
+            return false;
+        }
+        differentFieldValues.push_back(std::move(values));
+    }
+    indexes.assign(differentFields.size(), 0);
+    exhausted = false;
+    return true;
+}
+
+std::unique_ptr<UDRule> IsolateRule::Split::nextPiece() {
+    if (exhausted) {
+        return nullptr;
+    }
+    auto piece = rule->clone();
+    for (uint8_t i = 0; i < differentFields.size(); i++) {
+        piece->setField(differentFields[i], differentFieldValues[i][indexes[i]]->clone());
+    }
+    exhausted = true;
+    for (uint8_t i = 0; i < differentFields.size(); i++) {
+        if (indexes[i] < differentFieldValues[i].size() - 1) {
+            indexes[i]++;
+            exhausted = false;
+            break;
+        }
+        indexes[i] = 0;
+    }
+    return piece;
+}
+
+std::unique_ptr<UDRule> IsolateRule::materialize() const {
+    std::vector<Split> stack;
+    auto piece = rule.clone();
+    uint32_t next = 0;
+    while (true) {
+        // a piece is inside its parent, which does not overlap with the subtracted rules before next
+        while (next < subtracted.size() && !piece->overlap(*subtracted[next])) {
+            next++;
+        }
+        if (next == subtracted.size()) {
+            return piece;
+        }
+        stack.emplace_back();
+        stack.back().build(std::move(piece), *subtracted[next]);
+        stack.back().next = next + 1;
+        // backtrack to the deepest split with remaining pieces
+        while (!stack.empty() && (piece = stack.back().nextPiece()) == nullptr) {
+            stack.pop_back();
+        }
+        if (stack.empty()) {
+            return nullptr;
+        }
+        next = stack.back().next;
+    }
+}
+
+}
\ No newline at end of file
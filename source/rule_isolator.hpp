@@ -2,54 +2,239 @@
 
 // the first step to generate traces
 // we divide the rule pool into isolate rules which do not overlap with each other
-// note: if you generated a very large rule set, and the user-defined protocol has a lot of fields,
-//       our algorithm may be very slow and consume a lot of memory
+// every rule is split by the later rules overlapping with it (the later rule has a higher priority)
+// the overlapping rules are found by an overlap index, so we do not compare every pair of rules
+// and only the first piece of every rule is materialized (see rule_isolate.hpp)
+// for a large rule pool, the space is partitioned into regions by the top bits of an LPM field
+// every region only sees the rules intersecting it (clipped to the region), so the regions are
+// isolated independently (on multiple threads, see -t), and a rule is kept if it has a piece in any region
+// the regions only depend on the rule pool, so the result does not depend on the number of threads
+// note: if you generated a very large rule set with a lot of overlapping rules,
+//       our algorithm may still be slow
 // if rule-level spatial locality is not specified
 //       or fast mode is enabled, we omit this step and use the original rule pool
+// if the isolation fails (a rule is covered by the later rules), we also use the original rule pool
+//       the result is marked as not isolated (see UDRuleSetWithIndex::isIsolated), and it is reported in the summary
+//       the trace mode printed before this step is then not the mode used, so a warning suggests --rejection
+// if rejection mode is enabled, we also use the original rule pool
+//       and the flows are checked by rejection sampling (see rejection_sampler.hpp)
+// if the cache is enabled, the isolate rule set is loaded from or stored to the cache file (see isolation_cache.hpp)
+// in batch mode, the rule set is built once and shared by the jobs read-only (see trace_batch.hpp)
+
+#include <atomic>
+#include <iostream>
+#include <thread>
 
 #include "rule_pool.hpp"
-#include "rule_set_isolate.hpp"
+#include "rule_isolate.hpp"
+#include "rule_set_ud_index.hpp"
+#include "rule_overlap_index.hpp"
+#include "isolation_cache.hpp"
 
 namespace flowbench {
 
 class RuleIsolator : public Singleton<RuleIsolator> {
+private:
+    // about RULES_PER_REGION rules are assigned to a region
+    constexpr static uint32_t RULES_PER_REGION = 1024;
+    constexpr static uint8_t MAX_REGION_BITS = 12;
+    // a rule with a short prefix is copied to every region it intersects
+    // the number of copies should not exceed MAX_REPLICATION times the number of rules
+    constexpr static uint32_t MAX_REPLICATION = 2;
+
+    struct Region {
+        std::vector<uint32_t> ruleIndexes;          // the indexes of the rules in the rule pool, ascending
+        UDRuleSet rules;                            // the rules clipped to the region
+        std::vector<bool> clipped;                  // whether the rule is clipped (intersects other regions)
+        std::vector<std::unique_ptr<UDRule>> pieces; // the first piece of every rule in the region (or nullptr)
+    };
+
+    // the space is partitioned by the top regionBits bits of the regionField-th field
+    uint8_t regionField = 0;
+    uint8_t regionBits = 0;
+
+    // the first and the last region intersecting the field
+    std::pair<uint32_t, uint32_t> getRegionSpan(const MatchField& field, uint8_t bits) const {
+        if (bits == 0) {
+            return std::make_pair(0, 0);
+        }
+        return std::make_pair(field.getMinKey().first >> (64 - bits), field.getMaxKey().first >> (64 - bits));
+    }
+
+    void chooseRegions(const UDRuleSet& rulePool);
+    std::vector<Region> makeRegions(const UDRuleSet& rulePool) const;
+
+    // isolate the rules of a region
+    // set failed if a rule inside this region only is covered by the later rules
+    void isolate(Region& region, std::atomic<bool>& failed) const;
+
+    // take the first piece of every rule (in the order of the regions)
+    // return false if a rule has no piece in any region
+    bool merge(std::vector<Region>& regions, uint32_t ruleCount, UDRuleSetWithIndex& ruleSet) const;
+
+    // warn that the original rules are used instead of the isolate rules
+    static void warnFallback();
+
 public:
     RuleIsolator() = default;
 
-    std::unique_ptr<UDRuleSet> operator()();
+    // isolate: whether to split the rule pool into isolate rules (otherwise use the original rule pool)
+    // the result is not isolated if isolate is false or the isolation fails
+    std::unique_ptr<UDRuleSetWithIndex> operator()(bool isolate);
 };
 
-std::unique_ptr<UDRuleSet> RuleIsolator::operator()() {
-    auto ruleSet = std::make_unique<UDRuleSet>();
-    bool enableFastMode = TraceConfiguration::getInstance().enableFastMode();
-    if (!enableFastMode) {
-        std::vector<IsolateRuleSet> isolateRuleSets;
-        for (const auto& rule : RulePool::getInstance()) {
-            for (auto& isolateRuleSet : isolateRuleSets) {
-                if (!isolateRuleSet.splitBy(*rule)) {
-                    enableFastMode = true;
-                    break;
-                }
+void RuleIsolator::chooseRegions(const UDRuleSet& rulePool) {
+    regionField = 0;
+    regionBits = 0;
+    uint64_t ruleCount = rulePool.size();
+    uint8_t targetBits = 0;
+    while (targetBits < MAX_REGION_BITS && (static_cast<uint64_t>(RULES_PER_REGION) << (targetBits + 1)) <= ruleCount) {
+        targetBits++;
+    }
+    uint64_t bestCost = 0;
+    for (uint8_t i = 0; i < RuleTypeUD::getInstance().getFieldCount(); i++) {
+        if (RuleTypeUD::getInstance().getMatchType(i) != MatchType::LPM) {
+            continue;
+        }
+        // the most bits whose copies are acceptable, the fewer copies the better
+        uint8_t maxBits = std::min(targetBits, RuleTypeUD::getInstance().getFieldWidth(i));
+        for (uint8_t bits = maxBits; bits > 0 && bits >= regionBits; bits--) {
+            uint64_t cost = 0;
+            for (const auto& rule : rulePool) {
+                auto span = getRegionSpan(rule->getField(i), bits);
+                cost += span.second - span.first + 1;
             }
-            isolateRuleSets.emplace_back(*rule);
-            if (enableFastMode) {
+            if (cost <= MAX_REPLICATION * ruleCount) {
+                if (bits > regionBits || cost < bestCost) {
+                    regionField = i;
+                    regionBits = bits;
+                    bestCost = cost;
+                }
                 break;
             }
         }
-        if (!enableFastMode) {
-            for (auto& isolateRuleSet : isolateRuleSets) {
-                ruleSet->push_back(std::move(isolateRuleSet[0]));
+    }
+}
+
+std::vector<RuleIsolator::Region> RuleIsolator::makeRegions(const UDRuleSet& rulePool) const {
+    std::vector<Region> regions(1ull << regionBits);
+    for (uint32_t i = 0; i < rulePool.size(); i++) {
+        const auto& rule = rulePool.getRule(i);
+        auto span = getRegionSpan(rule.getField(regionField), regionBits);
+        if (span.first == span.second) {
+            regions[span.first].ruleIndexes.push_back(i);
+            regions[span.first].rules.push_back(rule.clone());
+            regions[span.first].clipped.push_back(false);
+            continue;
+        }
+        // an LPM field intersects 2^k regions, clip it by appending the k low bits of the region
+        uint8_t spanBits = 0;
+        while ((1ull << spanBits) < span.second - span.first + 1) {
+            spanBits++;
+        }
+        for (uint32_t r = span.first; r <= span.second; r++) {
+            auto field = rule.getField(regionField).clone();
+            field->addSuffix(r - span.first, spanBits);
+            auto clippedRule = rule.clone();
+            clippedRule->setField(regionField, std::move(field));
+            regions[r].ruleIndexes.push_back(i);
+            regions[r].rules.push_back(std::move(clippedRule));
+            regions[r].clipped.push_back(true);
+        }
+    }
+    return regions;
+}
+
+void RuleIsolator::isolate(Region& region, std::atomic<bool>& failed) const {
+    RuleOverlapIndex index(region.rules);
+    std::vector<uint32_t> overlapped;
+    region.pieces.resize(region.rules.size());
+    for (uint32_t i = 0; i < region.rules.size() && !failed; i++) {
+        IsolateRule isolateRule(region.rules.getRule(i));
+        // the pieces of a rule are inside the rule, so only the overlapping rules need to be subtracted
+        index.query(region.rules.getRule(i), i + 1, region.rules.size(), overlapped);
+        for (auto j : overlapped) {
+            isolateRule.subtract(region.rules.getRule(j));
+        }
+        region.pieces[i] = isolateRule.materialize();
+        if (region.pieces[i] == nullptr && !region.clipped[i]) {
+            failed = true;
+        }
+    }
+}
+
+bool RuleIsolator::merge(std::vector<Region>& regions, uint32_t ruleCount, UDRuleSetWithIndex& ruleSet) const {
+    std::vector<std::unique_ptr<UDRule>> pieces(ruleCount);
+    for (auto& region : regions) {
+        for (uint32_t j = 0; j < region.pieces.size(); j++) {
+            auto& piece = pieces[region.ruleIndexes[j]];
+            if (piece == nullptr) {
+                piece = std::move(region.pieces[j]);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < ruleCount; i++) {
+        if (pieces[i] == nullptr) {
+            return false;
+        }
+        ruleSet.push_back(std::move(pieces[i]), i);
+    }
+    return true;
+}
+
+void RuleIsolator::warnFallback() {
+    std::cerr << "Warning: a rule is covered by the later rules, so the rules cannot be isolated" << std::endl
+              << "         the original rules are used (Trace Mode: Fast), and a flow may be labeled with a rule"
+              << " which is not its highest-priority match" << std::endl
+              << "         use --rejection for exact rule labels" << std::endl;
+}
+
+std::unique_ptr<UDRuleSetWithIndex> RuleIsolator::operator()(bool isolate) {
+    bool enableCache = isolate && TraceConfiguration::getInstance().enableCache();
+    if (enableCache && IsolationCache::getInstance().isHit()) { // the rule pool may not be loaded
+        if (!IsolationCache::getInstance().isIsolated()) {
+            warnFallback();
+        }
+        return IsolationCache::getInstance().take();
+    }
+    auto ruleSet = std::make_unique<UDRuleSetWithIndex>();
+    const auto& rulePool = RulePool::getInstance();
+    bool enableFastMode = !isolate;
+    if (!enableFastMode) {
+        chooseRegions(rulePool);
+        auto regions = makeRegions(rulePool);
+        std::atomic<bool> failed(false);
+        std::atomic<uint32_t> next(0);
+        auto worker = [&]() {
+            for (uint32_t r = next++; r < regions.size(); r = next++) {
+                this->isolate(regions[r], failed);
             }
-        } else {
-            ruleSet->clear();
+        };
+        uint32_t threadCount = std::min<uint64_t>(TraceConfiguration::getInstance().getThreadCount(), regions.size());
+        std::vector<std::thread> threads;
+        for (uint32_t i = 1; i < threadCount; i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        enableFastMode = failed || !merge(regions, rulePool.size(), *ruleSet);
+        if (enableFastMode) {
+            warnFallback();
         }
     }
     if (enableFastMode) {
-        for (const auto& rule : RulePool::getInstance()) {
-            ruleSet->push_back(rule->clone());
+        ruleSet->clear();
+        for (uint32_t i = 0; i < rulePool.size(); i++) {
+            ruleSet->push_back(rulePool.getRule(i).clone(), i);
         }
     }
+    ruleSet->setIsolated(!enableFastMode);
     ruleSet->sortByAvailableWidth();
+    if (enableCache) {
+        IsolationCache::getInstance().save(*ruleSet, rulePool.size(), TraceConfiguration::getInstance().getCacheFilePath());
+    }
     return ruleSet;
 }
 
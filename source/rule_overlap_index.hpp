@@ -0,0 +1,191 @@
+#pragma once
+
+// a multi-field overlap index of a rule set
+// used to find the rules overlapping with a given rule without comparing it with every rule
+// every field of a rule is an interval [min, max] (see FieldKey)
+// two rules overlap iff their intervals overlap in every field
+// for each field, we keep
+// 1. the intervals sorted by min, with a segment tree of the maximum max
+// 2. the max values sorted
+// given a query interval [l, r], the number of intervals overlapping with it is
+//     #(min <= r) - #(max < l)
+// which costs 2 binary searches, so we choose the most selective field first
+// and enumerate the intervals with min <= r and max >= l on that field by the segment tree
+// the candidates are then checked on all fields
+// the time of a query is O(f * log n + k * (log n + f)), where k is the number of candidates
+// a query can also be a box of key intervals, e.g. a point to find the rules matching a header (see miss_generator.hpp)
+
+#include <algorithm>
+#include <vector>
+
+#include "rule_set.hpp"
+
+namespace flowbench {
+
+class RuleOverlapIndex {
+private:
+    class FieldIndex {
+    private:
+        std::vector<FieldKey> mins;     // the min values, sorted
+        std::vector<FieldKey> maxs;     // the max values, sorted
+        std::vector<uint32_t> order;    // the rule indexes sorted by min
+        std::vector<FieldKey> treeMax;  // the segment tree of the max values (in the order of min)
+        uint32_t leafBase = 1;
+
+    public:
+        void build(const UDRuleSet& ruleSet, uint8_t fieldIndex);
+
+        // the number of intervals overlapping with [l, r]
+        uint32_t count(const FieldKey& l, const FieldKey& r) const {
+            auto minCount = std::upper_bound(mins.begin(), mins.end(), r) - mins.begin();
+            auto maxCount = std::lower_bound(maxs.begin(), maxs.end(), l) - maxs.begin();
+            return minCount - maxCount;
+        }
+
+        // the indexes of the rules whose intervals overlap with [l, r] (unordered)
+        void enumerate(const FieldKey& l, const FieldKey& r, std::vector<uint32_t>& out) const;
+    };
+
+    const UDRuleSet& ruleSet;
+    std::vector<FieldIndex> fields;
+
+    // the rules overlapping with the box on its most selective field (unordered)
+    void enumerate(const std::vector<FieldKey>& lows, const std::vector<FieldKey>& highs, std::vector<uint32_t>& candidates) const;
+
+public:
+    explicit RuleOverlapIndex(const UDRuleSet& ruleSet);
+
+    // find the rules overlapping with the given rule, whose indexes are in [first, limit)
+    // the indexes are written to out in ascending order
+    void query(const UDRule& rule, uint32_t first, uint32_t limit, std::vector<uint32_t>& out) const;
+
+    void query(const UDRule& rule, uint32_t limit, std::vector<uint32_t>& out) const {
+        query(rule, 0, limit, out);
+    }
+
+    // find the rules overlapping with the box [lows[i], highs[i]] in every field
+    // the indexes are written to out in ascending order
+    void query(const std::vector<FieldKey>& lows, const std::vector<FieldKey>& highs, std::vector<uint32_t>& out) const;
+};
+
+void RuleOverlapIndex::FieldIndex::build(const UDRuleSet& ruleSet, uint8_t fieldIndex) {
+    uint32_t n = ruleSet.size();
+    order.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    std::vector<FieldKey> ruleMins(n), ruleMaxs(n);
+    for (uint32_t i = 0; i < n; i++) {
+        ruleMins[i] = ruleSet.getRule(i).getField(fieldIndex).getMinKey();
+        ruleMaxs[i] = ruleSet.getRule(i).getField(fieldIndex).getMaxKey();
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return ruleMins[a] < ruleMins[b];
+    });
+    mins.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        mins[i] = ruleMins[order[i]];
+    }
+    maxs = ruleMaxs;
+    std::sort(maxs.begin(), maxs.end());
+    leafBase = 1;
+    while (leafBase < n) {
+        leafBase <<= 1;
+    }
+    treeMax.assign(2 * leafBase, FieldKey(0, 0));
+    for (uint32_t i = 0; i < n; i++) {
+        treeMax[leafBase + i] = ruleMaxs[order[i]];
+    }
+    for (uint32_t i = leafBase - 1; i > 0; i--) {
+        treeMax[i] = std::max(treeMax[2 * i], treeMax[2 * i + 1]);
+    }
+}
+
+void RuleOverlapIndex::FieldIndex::enumerate(const FieldKey& l, const FieldKey& r, std::vector<uint32_t>& out) const {
+    // only the first end intervals (in the order of min) have min <= r
+    uint32_t end = std::upper_bound(mins.begin(), mins.end(), r) - mins.begin();
+    if (end == 0) {
+        return;
+    }
+    // visit the subtrees within [0, end) whose maximum max >= l
+    // a node covers the leaves [first, first + width)
+    struct Node {
+        uint32_t node, first, width;
+    };
+    std::vector<Node> stack = {{1, 0, leafBase}};
+    while (!stack.empty()) {
+        Node current = stack.back();
+        stack.pop_back();
+        if (current.first >= end || treeMax[current.node] < l) {
+            continue;
+        }
+        if (current.width == 1) {
+            out.push_back(order[current.first]);
+        } else {
+            uint32_t half = current.width / 2;
+            stack.push_back({2 * current.node + 1, current.first + half, half});
+            stack.push_back({2 * current.node, current.first, half});
+        }
+    }
+}
+
+RuleOverlapIndex::RuleOverlapIndex(const UDRuleSet& ruleSet) : ruleSet(ruleSet) {
+    uint8_t fieldCount = RuleTypeUD::getInstance().getFieldCount();
+    fields.resize(fieldCount);
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        fields[i].build(ruleSet, i);
+    }
+}
+
+void RuleOverlapIndex::enumerate(const std::vector<FieldKey>& lows, const std::vector<FieldKey>& highs,
+                                 std::vector<uint32_t>& candidates) const {
+    uint8_t best = 0;
+    uint32_t bestCount = UINT32_MAX;
+    for (uint8_t i = 0; i < fields.size(); i++) {
+        uint32_t count = fields[i].count(lows[i], highs[i]);
+        if (count < bestCount) {
+            best = i;
+            bestCount = count;
+        }
+    }
+    if (bestCount == 0) {
+        return;
+    }
+    fields[best].enumerate(lows[best], highs[best], candidates);
+}
+
+void RuleOverlapIndex::query(const UDRule& rule, uint32_t first, uint32_t limit, std::vector<uint32_t>& out) const {
+    out.clear();
+    std::vector<FieldKey> lows(fields.size()), highs(fields.size());
+    for (uint8_t i = 0; i < fields.size(); i++) {
+        lows[i] = rule.getField(i).getMinKey();
+        highs[i] = rule.getField(i).getMaxKey();
+    }
+    std::vector<uint32_t> candidates;
+    enumerate(lows, highs, candidates);
+    for (auto index : candidates) {
+        if (index >= first && index < limit && ruleSet.getRule(index).overlap(rule)) {
+            out.push_back(index);
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
+
+void RuleOverlapIndex::query(const std::vector<FieldKey>& lows, const std::vector<FieldKey>& highs, std::vector<uint32_t>& out) const {
+    out.clear();
+    std::vector<uint32_t> candidates;
+    enumerate(lows, highs, candidates);
+    for (auto index : candidates) {
+        const auto& rule = ruleSet.getRule(index);
+        bool overlap = true;
+        for (uint8_t i = 0; i < fields.size() && overlap; i++) {
+            overlap = rule.getField(i).getMinKey() <= highs[i] && rule.getField(i).getMaxKey() >= lows[i];
+        }
+        if (overlap) {
+            out.push_back(index);
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
+
+}
\ No newline at end of file
@@ -39,7 +39,8 @@ public:
     }
 
 public:
-    void sortByAvailableWidth() {
+    // return the original indexes of the sorted rules
+    std::vector<uint32_t> sortByAvailableWidth() {
         std::vector<std::pair<uint32_t, uint32_t>> ruleWidths;
         for (uint32_t i = 0; i < this->size(); i++) {
             ruleWidths.push_back(std::make_pair(i, getRule(i).getAvailableWidth()));
@@ -48,10 +49,13 @@ public:
             return a.second < b.second;
         });
         std::vector<std::unique_ptr<Rule<T>>> rules;
+        std::vector<uint32_t> order;
         for (uint32_t i = 0; i < this->size(); i++) {
             rules.push_back(std::move(this->at(ruleWidths[i].first)));
+            order.push_back(ruleWidths[i].first);
         }
         this->swap(rules);
+        return order;
     }
 
 };
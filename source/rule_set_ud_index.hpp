@@ -2,6 +2,7 @@
 
 // user-defined rule set with index
 // for trace generator, every flow has a rule index
+// the index is the position of the original rule in the rule pool (the input file)
 
 #include "rule_set.hpp"
 
@@ -10,6 +11,7 @@ namespace flowbench {
 class UDRuleSetWithIndex : public UDRuleSet {
 private:
     std::vector<uint32_t> ruleIndex;
+    bool isolated = false;
 
 public:
     void push_back(std::unique_ptr<UDRule>&& rule, uint32_t index) {
@@ -21,6 +23,31 @@ public:
         return ruleIndex[index];
     }
 
+    // whether the rules are isolate rules (see rule_isolator.hpp)
+    // otherwise they are the original rules, and a flow of a rule may also match a later rule with a higher priority
+    bool isIsolated() const {
+        return isolated;
+    }
+
+    void setIsolated(bool isolated) {
+        this->isolated = isolated;
+    }
+
+    void clear() {
+        UDRuleSet::clear();
+        ruleIndex.clear();
+    }
+
+    // sort the rules by available width, the indexes are moved with the rules
+    void sortByAvailableWidth() {
+        auto order = UDRuleSet::sortByAvailableWidth();
+        std::vector<uint32_t> sortedIndex;
+        for (auto i : order) {
+            sortedIndex.push_back(ruleIndex[i]);
+        }
+        ruleIndex.swap(sortedIndex);
+    }
+
 };
 
 
@@ -53,21 +53,37 @@ public:
         matchTypes[fieldIndex] = matchType;
     }
 
-    void setProtocol(Protocol protocol) {
-        RuleType* ruleType = nullptr;
+    // the rule type of a pre-defined protocol (nullptr if unknown)
+    static const RuleType* getRuleType(Protocol protocol) {
         switch (protocol) {
             case Protocol::IPv4:
-                ruleType = &RuleTypeIPv4::getInstance();
-                break;
+                return &RuleTypeIPv4::getInstance();
             case Protocol::IPv6:
-                ruleType = &RuleTypeIPv6::getInstance();
-                break;
+                return &RuleTypeIPv6::getInstance();
             case Protocol::OpenFlow1_0:
-                ruleType = &RuleTypeOpenFlow1_0::getInstance();
-                break;
+                return &RuleTypeOpenFlow1_0::getInstance();
             default:
-                break;
+                return nullptr;
         }
+    }
+
+    // the pre-defined protocol with the same fields (Protocol::Unknown if none)
+    Protocol getProtocol() const {
+        for (auto protocol : { Protocol::IPv4, Protocol::IPv6, Protocol::OpenFlow1_0 }) {
+            const RuleType* ruleType = getRuleType(protocol);
+            bool same = ruleType->getFieldCount() == fieldCount;
+            for (uint8_t i = 0; same && i < fieldCount; i++) {
+                same = ruleType->getFieldWidth(i) == fieldWidths[i] && ruleType->getMatchType(i) == matchTypes[i];
+            }
+            if (same) {
+                return protocol;
+            }
+        }
+        return Protocol::Unknown;
+    }
+
+    void setProtocol(Protocol protocol) {
+        const RuleType* ruleType = getRuleType(protocol);
         if (ruleType != nullptr) {
             fieldCount = ruleType->getFieldCount();
             fieldWidths.resize(fieldCount);
@@ -39,13 +39,14 @@ public:
     // p : state.p on the current layer, will be updated to the sum of parameters on next layer
     // p1 : the intra-layer parameter of the selected QuadDag
     // profile : the profile of the selected QuadDag
-    void select(ProblemState& state, const QuadDagProfile& profile);
+    // return : false if no virtual rule can be selected for some of the children
+    bool select(ProblemState& state, const QuadDagProfile& profile);
 
 };
 
 const NormalDistribution VirtualRuleSelector::dist(mean, variance);
 
-void VirtualRuleSelector::select(ProblemState& state, const QuadDagProfile& profile) {
+bool VirtualRuleSelector::select(ProblemState& state, const QuadDagProfile& profile) {
     uint32_t n = state.n;
     uint32_t p = state.p;
     uint8_t p1 = profile.getTotalParameter();
@@ -85,6 +86,9 @@ void VirtualRuleSelector::select(ProblemState& state, const QuadDagProfile& prof
             }
         }
         uint32_t index = RandomSelector::getInstance().select(weights);
+        if (index == NO_CANDIDATE) {
+            return false;
+        }
         result.push_back(index);
         p -= divider.result[i] * profile.getVirtualRules().getParameter(index);
     }
@@ -117,6 +121,7 @@ void VirtualRuleSelector::select(ProblemState& state, const QuadDagProfile& prof
         parameters.resize(result.size());
         std::fill(parameters.begin(), parameters.end(), 0);
     }
+    return true;
 }
 
 }
\ No newline at end of file
@@ -28,43 +28,46 @@ public:
     // 3. if the rule is "virtual", then it is allowed to have wildcard in the next layer
     std::vector<bool> allowWildcard;
 
-    // split the virtual rules into a new rule set
+    // plan the split without materializing the mixed rule set
     // n : state.n on the current layer
     // profile : the profile of the selected QuadDag
-    // return : the mixed rule set of solid rules and splitted virtual rules
+    // return : the size of the mixed rule set
     //          if size of the result > 4, then there are virtual rules
-    std::unique_ptr<CandidateRuleSet> split(const ProblemState& state, const QuadDagProfile& profile);
+    uint32_t plan(const ProblemState& state, const QuadDagProfile& profile);
+
+    // get the fields of the index-th rule in the planned mixed rule set
+    // the fields are copied from the profile, and the suffix is added if the virtual rule is split
+    // return : false if the field is not wide enough for the suffix
+    bool getFields(uint32_t index, const QuadDagProfile& profile, std::array<LpmField<Int32>, QD_FIELD_CNT>& fields) const;
 
 private:
     std::vector<uint32_t> counter;
     std::vector<bool> conflict;
+
+    // the suffixes added to the selected virtual rules
+    // only valid if splitted[i] is true
+    std::vector<uint32_t> suffixes;
+    std::vector<bool> splitted;
+    uint32_t conflictSolveFieldIndex = 0;
+    uint32_t conflictWidth = 0;
 };
 
-std::unique_ptr<CandidateRuleSet> VirtualRuleSplitter::split(const ProblemState& state, const QuadDagProfile& profile) {
-    uint32_t n = state.n, count = 0;
-    auto result = std::make_unique<CandidateRuleSet>();
+uint32_t VirtualRuleSplitter::plan(const ProblemState& state, const QuadDagProfile& profile) {
+    uint32_t n = state.n;
     if (n <= QD_VERTEX_CNT) {
-        count = n;
-    } else {
-        count = QD_VERTEX_CNT + virtualRuleIndexes.size();
+        return n;
     }
-    result->resize(count);
-    const auto& solidRules = profile.getSolidRules();
     const auto& virtualRules = profile.getVirtualRules();
-    for (uint32_t i = 0; i < std::min<uint32_t>(n, QD_VERTEX_CNT); i++) {
-        result->at(i) = solidRules.getRule(i).clone();
-    }
-    if (n <= QD_VERTEX_CNT) {
-        return result;
-    }
-    uint32_t conflictSolveFieldIndex = Random::getInstance().nextInt32(0, profile.getActualFieldCount() - 1);
-    uint32_t conflictWidth = 0;
+    conflictSolveFieldIndex = Random::getInstance().nextInt32(0, profile.getActualFieldCount() - 1);
+    conflictWidth = 0;
     uint32_t maxCounter = 0;
     counter.resize(virtualRules.size());
     conflict.resize(virtualRules.size());
     std::fill(counter.begin(), counter.end(), 0);
     std::fill(conflict.begin(), conflict.end(), false);
     allowWildcard.resize(virtualRuleIndexes.size());
+    suffixes.resize(virtualRuleIndexes.size());
+    splitted.resize(virtualRuleIndexes.size());
     for (uint8_t i = 0; i < virtualRuleIndexes.size(); i++) {
         uint8_t index = virtualRuleIndexes[i];
         counter[index]++;
@@ -80,14 +83,29 @@ std::unique_ptr<CandidateRuleSet> VirtualRuleSplitter::split(const ProblemState&
     }
     for (uint8_t i = 0; i < virtualRuleIndexes.size(); i++) {
         uint8_t index = virtualRuleIndexes[i];
-        auto rule = virtualRules.getRule(index).clone();
-        if (conflictWidth > 0 && conflict[index]) {
-            rule->getFieldAs<LpmField<Int32>>(conflictSolveFieldIndex).addSuffix(Int32(--counter[index]), conflictWidth);
+        splitted[i] = (conflictWidth > 0 && conflict[index]);
+        if (splitted[i]) {
+            suffixes[i] = --counter[index];
         }
-        result->at(i + QD_VERTEX_CNT) = std::move(rule);
         allowWildcard[i] = (!virtualRules.isSolid(index) || conflict[index]);
     }
-    return result;
+    return QD_VERTEX_CNT + virtualRuleIndexes.size();
+}
+
+bool VirtualRuleSplitter::getFields(uint32_t index, const QuadDagProfile& profile, std::array<LpmField<Int32>, QD_FIELD_CNT>& fields) const {
+    const CandidateRule* rule;
+    if (index < QD_VERTEX_CNT) {
+        rule = &profile.getSolidRules().getRule(index);
+    } else {
+        rule = &profile.getVirtualRules().getRule(virtualRuleIndexes[index - QD_VERTEX_CNT]);
+    }
+    for (uint8_t i = 0; i < QD_FIELD_CNT; i++) {
+        fields[i] = rule->getFieldAs<LpmField<Int32>>(i);
+    }
+    if (index >= QD_VERTEX_CNT && splitted[index - QD_VERTEX_CNT]) {
+        return fields[conflictSolveFieldIndex].addSuffix(Int32(suffixes[index - QD_VERTEX_CNT]), conflictWidth);
+    }
+    return true;
 }
 
 }
\ No newline at end of file
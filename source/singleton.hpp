@@ -38,4 +38,38 @@ protected:
 template <class T>
 std::unique_ptr<T> Singleton<T>::instance = nullptr;
 
+// a singleton class template with an instance per thread
+// for the classes holding the state of a job, so that the jobs can run concurrently (see trace_batch.hpp)
+template <class T>
+class ThreadLocalSingleton {
+private:
+    static thread_local std::unique_ptr<T> instance;
+
+public:
+    static T& getInstance() {
+        if (instance == nullptr) {
+            instance = std::make_unique<T>();
+        }
+        return *instance;
+    }
+
+    template <typename... Args>
+    static void setInstance(Args&&... args) {
+        instance = std::make_unique<T>(std::forward<Args>(args)...);
+    }
+
+    ThreadLocalSingleton(const ThreadLocalSingleton& other) = delete;
+    ThreadLocalSingleton(ThreadLocalSingleton&& other) = delete;
+    ThreadLocalSingleton& operator=(const ThreadLocalSingleton& other) = delete;
+    ThreadLocalSingleton& operator=(ThreadLocalSingleton&& other) = delete;
+
+protected:
+    ThreadLocalSingleton() = default;
+    virtual ~ThreadLocalSingleton() = default;
+
+};
+
+template <class T>
+thread_local std::unique_ptr<T> ThreadLocalSingleton<T>::instance = nullptr;
+
 }
\ No newline at end of file
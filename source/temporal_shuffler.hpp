@@ -0,0 +1,135 @@
+#pragma once
+
+// order the packets of the trace by temporal locality (--temporal)
+// a uniform shuffle makes every packet independent of the previous ones, so a flow cache hits much less than in real traffic
+// instead, we keep the flows in an LRU stack, and the next packet reuses the flow at a random stack distance
+// 1. at first, all the flows are in the stack in a random order, none of them has been used
+// 2. for every packet, draw a distance d from the distribution (d = count - 1, see count_distribution.hpp)
+//    the packet belongs to the flow at depth d (0 is the most recently used flow, the last one if d is too large)
+//    then the flow is moved to the top, or removed from the stack if all its packets are used
+// so the number of packets of every flow is kept, and a small distance means a high temporal locality
+// the stack is a Fenwick tree over timestamps: a flow is stored at the timestamp of its last use
+// the flow at depth d is the (n - d)-th occupied timestamp, which is found in O(log F)
+// the timestamps are compacted when they run out, which takes O(F) every F packets at least
+
+#include <vector>
+
+#include "count_distribution.hpp"
+#include "random.hpp"
+#include "singleton.hpp"
+
+namespace flowbench {
+
+class TemporalShuffler : public ThreadLocalSingleton<TemporalShuffler> {
+private:
+    constexpr static uint32_t BLOCK_SIZE = 4096;
+    constexpr static uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<uint32_t> tree;    // the Fenwick tree of the occupied timestamps (1-indexed)
+    std::vector<uint32_t> owners;  // the flow at every timestamp (EMPTY if not occupied)
+    std::vector<uint32_t> remains; // the number of packets left for every flow
+    uint32_t nextTimestamp = 0;
+    uint32_t stackSize = 0;
+    uint32_t highBit = 1;
+
+    void add(uint32_t timestamp, int32_t delta) {
+        for (uint32_t i = timestamp + 1; i < tree.size(); i += i & -i) {
+            tree[i] += delta;
+        }
+    }
+
+    // the timestamp of the k-th occupied timestamp (1-indexed)
+    uint32_t find(uint32_t k) const {
+        uint32_t position = 0;
+        for (uint32_t step = highBit; step > 0; step >>= 1) {
+            if (position + step < tree.size() && tree[position + step] < k) {
+                position += step;
+                k -= tree[position];
+            }
+        }
+        return position;
+    }
+
+    // move the flows in the stack to the timestamps [0, stackSize), and rebuild the tree in O(F)
+    void compact();
+
+public:
+    TemporalShuffler() = default;
+
+    // packets: the flow ID of every packet, the packets of a flow are adjacent
+    void operator()(std::vector<uint32_t>& packets, uint32_t flowCount, const CountDistribution& distanceDistribution);
+};
+
+constexpr uint32_t TemporalShuffler::BLOCK_SIZE;
+constexpr uint32_t TemporalShuffler::EMPTY;
+
+void TemporalShuffler::compact() {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < nextTimestamp; i++) {
+        if (owners[i] != EMPTY) {
+            owners[size++] = owners[i];
+        }
+    }
+    std::fill(owners.begin() + size, owners.end(), EMPTY);
+    nextTimestamp = size;
+    // the linear construction of the Fenwick tree
+    std::fill(tree.begin(), tree.end(), 0);
+    for (uint32_t i = 1; i < tree.size(); i++) {
+        tree[i] += i <= size ? 1 : 0;
+        uint32_t parent = i + (i & -i);
+        if (parent < tree.size()) {
+            tree[parent] += tree[i];
+        }
+    }
+}
+
+void TemporalShuffler::operator()(std::vector<uint32_t>& packets, uint32_t flowCount, const CountDistribution& distanceDistribution) {
+    remains.assign(flowCount, 0);
+    for (auto flowId : packets) {
+        remains[flowId]++;
+    }
+    // the flows in a random order (Fisher-Yates), the last one is on the top of the stack
+    owners.assign(2 * static_cast<uint64_t>(flowCount) + 1, EMPTY);
+    stackSize = 0;
+    for (uint32_t flowId = 0; flowId < flowCount; flowId++) {
+        if (remains[flowId] > 0) {
+            owners[stackSize++] = flowId;
+        }
+    }
+    for (uint32_t i = stackSize; i > 1; i--) {
+        std::swap(owners[i - 1], owners[Random::getInstance().nextUInt32(0, i - 1)]);
+    }
+    tree.assign(owners.size() + 1, 0);
+    nextTimestamp = stackSize;
+    compact();
+    highBit = 1;
+    while (highBit * 2 < tree.size()) {
+        highBit *= 2;
+    }
+
+    std::vector<uint32_t> distances(BLOCK_SIZE);
+    uint32_t used = BLOCK_SIZE;
+    for (auto& packet : packets) {
+        if (used == BLOCK_SIZE) {
+            distanceDistribution.fill(distances);
+            used = 0;
+        }
+        uint32_t depth = std::min(distances[used++] - 1, stackSize - 1);
+        uint32_t timestamp = find(stackSize - depth);
+        uint32_t flowId = owners[timestamp];
+        packet = flowId;
+        owners[timestamp] = EMPTY;
+        add(timestamp, -1);
+        if (--remains[flowId] == 0) {
+            stackSize--;
+            continue;
+        }
+        if (nextTimestamp == owners.size()) {
+            compact();
+        }
+        owners[nextTimestamp] = flowId;
+        add(nextTimestamp++, 1);
+    }
+}
+
+}
\ No newline at end of file
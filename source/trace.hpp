@@ -1,39 +1,388 @@
 #pragma once
 
 // trace to be printed
+// a trace is a flow table and a packet sequence
+// 1. the flow table keeps every flow once: its packed header and its rule index
+//    the header of a flow is the value of every field (the high `width` bits), big-endian,
+//    in (width + 7) / 8 bytes per field, so all the headers have the same size
+// 2. the packet sequence keeps the flow ID of every packet (4 bytes per packet)
+// the flows of different rules are written to disjoint ranges of the tables, so they can be written concurrently
+// the packets are shuffled as integers, and the lines are formatted from the headers when printed
+// the trace is printed as text lines, or as the fixed-size records of the binary trace (--binary, see trace_reader.hpp)
+// in stream mode (--stream), the packet sequence is not stored, only the end of the packets of every flow
+// the j-th packet of the output is the p(j)-th packet of the flows in order, where p is a keyed permutation
+// (see feistel_permutation.hpp), so any range of the output can be printed without the others
+// with flow churn (--churn), the packets are ordered by the arrivals and the lifetimes of the flows (see churn_scheduler.hpp)
+// in stream mode, the order is generated again when the packets are printed
+// the binary trace and the pcap file carry the timestamps of the packets, generated when printed (see rate_model.hpp)
 
+#include <algorithm>
+#include <cstring>
+
+#include "churn_scheduler.hpp"
+#include "feistel_permutation.hpp"
 #include "flow.hpp"
+#include "random.hpp"
+#include "rate_model.hpp"
 #include "rule_format.hpp"
+#include "temporal_shuffler.hpp"
+#include "trace_reader.hpp"
 
 namespace flowbench {
 
-class Trace : public std::vector<std::unique_ptr<Flow>> {
+class Trace {
+private:
+    // the layout of a header
+    std::vector<uint8_t> fieldWidths;
+    std::vector<uint32_t> fieldOffsets;
+    uint32_t headerSize = 0;
+
+    std::vector<uint8_t> headers;
+    std::vector<uint32_t> ruleIndexes;
+    std::vector<uint32_t> packets;
+    uint32_t packetCount = 0;
+
+    // stream mode: the end of the packets of every flow (prefix sums), and the permutation of the packets
+    bool streamMode = false;
+    std::vector<uint32_t> flowEnds;
+    std::unique_ptr<FeistelPermutation> permutation;
+
+    // flow churn: the distribution of the lifetimes (nullptr if disabled) and the seed of the scheduler
+    std::unique_ptr<CountDistribution> lifetimeDistribution;
+    uint32_t churnSeed = 0;
+
+    // the timestamps of the packets: the rate model and the seed of the timestamp generator
+    RateModel rateModel;
+    uint32_t timestampSeed = 0;
+
+    // the value of the index-th field of a flow, (high 64 bits, low 64 bits)
+    std::pair<uint64_t, uint64_t> getValue(uint32_t flowId, uint8_t index) const;
+
+    // format a line of the packet into the buffer, return the end of the line
+    char* formatFlowBench(uint32_t flowId, char* buffer) const;
+    char* formatClassBench(uint32_t flowId, char* buffer) const;
+
 public:
     Trace() = default;
 
-    void print(std::ostream& os) const;
+    // clear the trace and set the layout according to the current protocol
+    void clear(bool streamMode = false);
+
+    // allocate the flow table and the packet sequence
+    void resize(uint32_t flowCount, uint32_t packetCount);
+
+    // set the flow of the flow ID in the flow table
+    void setFlow(uint32_t flowId, const Flow& flow);
+
+    // the packets of the flow are [begin, begin + count) of the packet sequence (before shuffling)
+    // the packets of the flows should be in the order of the flow IDs
+    void setPackets(uint32_t flowId, uint32_t begin, uint32_t count) {
+        if (streamMode) {
+            flowEnds[flowId] = begin + count;
+        } else {
+            std::fill(packets.begin() + begin, packets.begin() + begin + count, flowId);
+        }
+    }
+
+    // Fisher-Yates shuffle of the packets with our own random engine, so the order only depends on the seed
+    // in stream mode, only the key of the permutation is drawn
+    // if the distribution of the stack distances is given, the packets are ordered by temporal locality instead
+    // if the distribution of the lifetimes is given, the packets are ordered by flow churn instead
+    void shuffle(const CountDistribution* temporalDistribution = nullptr, const CountDistribution* lifetimeDistribution = nullptr);
+
+    // set the rate model of the timestamps, the seed of the timestamp generator is drawn
+    void setRateModel(const RateModel& rateModel) {
+        this->rateModel = rateModel;
+        timestampSeed = Random::getInstance().nextUInt32();
+    }
+
+    uint32_t getFlowCount() const {
+        return ruleIndexes.size();
+    }
+
+    uint32_t getPacketCount() const {
+        return packetCount;
+    }
+
+    // not available in stream mode with flow churn, the packets should be visited in order (see visitPackets)
+    uint32_t getFlowId(uint32_t packetIndex) const {
+        if (!streamMode) {
+            return packets[packetIndex];
+        }
+        uint32_t position = (*permutation)(packetIndex);
+        return std::upper_bound(flowEnds.begin(), flowEnds.end(), position) - flowEnds.begin();
+    }
+
+    uint32_t getRuleIndex(uint32_t flowId) const {
+        return ruleIndexes[flowId];
+    }
+
+    uint32_t getHeaderSize() const {
+        return headerSize;
+    }
+
+    const uint8_t* getHeader(uint32_t flowId) const {
+        return headers.data() + static_cast<uint64_t>(flowId) * headerSize;
+    }
+
+    // the bytes of the index-th field of a flow (big-endian)
+    const uint8_t* getField(uint32_t flowId, uint8_t index) const {
+        return getHeader(flowId) + fieldOffsets[index];
+    }
+
+    // call visit(packetIndex, flowId) for every packet in [begin, end) in order
+    template <class Visitor>
+    void visitPackets(uint32_t begin, uint32_t end, Visitor visit) const;
+
+    // call visit(packetIndex, flowId, timestamp) for every packet in [begin, end) in order, timestamp in nanoseconds
+    // the timestamps are generated from the first packet, so they do not depend on begin
+    template <class Visitor>
+    void visitTimedPackets(uint32_t begin, uint32_t end, Visitor visit) const;
+
+    // print the packets in [begin, end)
+    void print(std::ostream& os, uint32_t begin, uint32_t end) const;
+
+    void print(std::ostream& os) const {
+        print(os, 0, packetCount);
+    }
+
+    // print the packets in [begin, end) as a binary trace
+    void printBinary(std::ostream& os, uint32_t begin, uint32_t end) const;
 };
 
-void Trace::print(std::ostream& os) const {
-    auto style = RuleFormat::outputFormat.getStyle();
-    if (style == RuleOutputStyle::FlowBench) {
-        for (const auto& flow : *this) {
-            for (uint8_t i = 0; i < RuleTypeUD::getInstance().getFieldCount(); i++) {
-                os << "0x" << flow->getField(i).toHexString(RuleTypeUD::getInstance().getFieldWidth(i)) << " ";
-            }
-            os << " " << flow->getRuleIndex() << "\n";
-        }
-    } else if (style == RuleOutputStyle::ClassBench) {
-        for (const auto& flow : *this) {
-            for (uint8_t i = 0; i < RuleTypeUD::getInstance().getFieldCount(); i++) {
-                os << flow->getField(i).toDecimalString(RuleTypeUD::getInstance().getFieldWidth(i));
-                if (i < RuleTypeUD::getInstance().getFieldCount() - 1) {
-                    os << ",";
-                }
+void Trace::clear(bool streamMode) {
+    this->streamMode = streamMode;
+    uint8_t fieldCount = RuleTypeUD::getInstance().getFieldCount();
+    fieldWidths.resize(fieldCount);
+    fieldOffsets.resize(fieldCount);
+    headerSize = 0;
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        fieldWidths[i] = RuleTypeUD::getInstance().getFieldWidth(i);
+        fieldOffsets[i] = headerSize;
+        headerSize += (fieldWidths[i] + 7) / 8;
+    }
+    headers.clear();
+    ruleIndexes.clear();
+    packets.clear();
+    packetCount = 0;
+    flowEnds.clear();
+    permutation.reset();
+    lifetimeDistribution.reset();
+}
+
+void Trace::shuffle(const CountDistribution* temporalDistribution, const CountDistribution* lifetimeDistribution) {
+    if (lifetimeDistribution != nullptr) {
+        this->lifetimeDistribution = lifetimeDistribution->clone();
+        churnSeed = Random::getInstance().nextUInt32();
+        if (streamMode) {
+            return;
+        }
+        flowEnds.assign(getFlowCount(), 0);
+        for (auto flowId : packets) {
+            flowEnds[flowId]++;
+        }
+        for (uint32_t i = 1; i < flowEnds.size(); i++) {
+            flowEnds[i] += flowEnds[i - 1];
+        }
+        ChurnScheduler scheduler(flowEnds, *this->lifetimeDistribution, churnSeed);
+        for (auto& packet : packets) {
+            packet = scheduler.next();
+        }
+        std::vector<uint32_t>().swap(flowEnds);
+        return;
+    }
+    if (temporalDistribution != nullptr && !streamMode) {
+        TemporalShuffler::getInstance()(packets, getFlowCount(), *temporalDistribution);
+        return;
+    }
+    if (streamMode) {
+        uint64_t key = static_cast<uint64_t>(Random::getInstance().nextUInt32()) << 32 | Random::getInstance().nextUInt32();
+        permutation = std::make_unique<FeistelPermutation>(packetCount, key);
+        return;
+    }
+    for (uint32_t i = packets.size(); i > 1; i--) {
+        std::swap(packets[i - 1], packets[Random::getInstance().nextUInt32(0, i - 1)]);
+    }
+}
+
+void Trace::resize(uint32_t flowCount, uint32_t packetCount) {
+    headers.resize(static_cast<uint64_t>(flowCount) * headerSize);
+    ruleIndexes.resize(flowCount);
+    if (streamMode) {
+        flowEnds.resize(flowCount);
+    } else {
+        packets.resize(packetCount);
+    }
+    this->packetCount = packetCount;
+}
+
+void Trace::setFlow(uint32_t flowId, const Flow& flow) {
+    uint64_t offset = static_cast<uint64_t>(flowId) * headerSize;
+    for (uint8_t i = 0; i < fieldWidths.size(); i++) {
+        // the value is left-aligned in 128 bits, take the high `width` bits
+        uint8_t width = fieldWidths[i];
+        uint64_t high = flow.getField(i).getHighBits();
+        uint64_t low = flow.getField(i).getLowBits();
+        if (width <= 64) {
+            low = width == 0 ? 0 : high >> (64 - width);
+            high = 0;
+        } else if (width < 128) {
+            low = low >> (128 - width) | high << (width - 64);
+            high >>= 128 - width;
+        }
+        uint8_t* bytes = headers.data() + offset + fieldOffsets[i];
+        for (int j = (width + 7) / 8 - 1; j >= 0; j--) {
+            bytes[j] = static_cast<uint8_t>(low);
+            low = low >> 8 | high << 56;
+            high >>= 8;
+        }
+    }
+    ruleIndexes[flowId] = flow.getRuleIndex();
+}
+
+std::pair<uint64_t, uint64_t> Trace::getValue(uint32_t flowId, uint8_t index) const {
+    const uint8_t* bytes = getHeader(flowId) + fieldOffsets[index];
+    uint64_t high = 0;
+    uint64_t low = 0;
+    for (uint32_t j = 0; j < (fieldWidths[index] + 7u) / 8; j++) {
+        high = high << 8 | low >> 56;
+        low = low << 8 | bytes[j];
+    }
+    return std::make_pair(high, low);
+}
+
+char* Trace::formatFlowBench(uint32_t flowId, char* buffer) const {
+    for (uint8_t i = 0; i < fieldWidths.size(); i++) {
+        auto value = getValue(flowId, i);
+        uint8_t digitCount = (fieldWidths[i] + 3) / 4;
+        *buffer++ = '0';
+        *buffer++ = 'x';
+        for (int j = digitCount - 1; j >= 0; j--) {
+            uint64_t part = j < 16 ? value.second : value.first;
+            buffer[digitCount - 1 - j] = "0123456789abcdef"[part >> (j % 16 * 4) & 0xf];
+        }
+        buffer += digitCount;
+        *buffer++ = ' ';
+    }
+    *buffer++ = ' ';
+    return buffer;
+}
+
+char* Trace::formatClassBench(uint32_t flowId, char* buffer) const {
+    uint8_t fieldCount = fieldWidths.size();
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        auto value = getValue(flowId, i);
+        std::string text = std::to_string(value.second);
+        if (fieldWidths[i] > 64) { // the high bits and the low bits are separated by '
+            text = std::to_string(value.first) + "'" + text;
+        }
+        memcpy(buffer, text.data(), text.size());
+        buffer += text.size();
+        if (i + 1 < fieldCount) {
+            *buffer++ = ',';
+        }
+    }
+    *buffer++ = ' ';
+    return buffer;
+}
+
+template <class Visitor>
+void Trace::visitPackets(uint32_t begin, uint32_t end, Visitor visit) const {
+    end = std::min(end, packetCount);
+    if (streamMode && lifetimeDistribution != nullptr) {
+        // the order is generated from the first packet, and the packets before begin are skipped
+        ChurnScheduler scheduler(flowEnds, *lifetimeDistribution, churnSeed);
+        for (uint32_t j = 0; j < end; j++) {
+            uint32_t flowId = scheduler.next();
+            if (j >= begin) {
+                visit(j, flowId);
             }
-            os << " " << flow->getRuleIndex() << "\n";
         }
+        return;
+    }
+    for (uint32_t j = begin; j < end; j++) {
+        visit(j, getFlowId(j));
     }
 }
 
+template <class Visitor>
+void Trace::visitTimedPackets(uint32_t begin, uint32_t end, Visitor visit) const {
+    TimestampGenerator generator(rateModel, timestampSeed);
+    // the flows of the packets before begin are only visited if the timestamps depend on them
+    uint32_t first = rateModel.dependsOnFlows() ? 0 : std::min(begin, end);
+    generator.skip(first);
+    visitPackets(first, end, [&](uint32_t j, uint32_t flowId) {
+        uint64_t timestamp = generator.next(flowId);
+        if (j >= begin) {
+            visit(j, flowId, timestamp);
+        }
+    });
+}
+
+void Trace::print(std::ostream& os, uint32_t begin, uint32_t end) const {
+    auto style = RuleFormat::outputFormat.getStyle();
+    if (style != RuleOutputStyle::FlowBench && style != RuleOutputStyle::ClassBench) {
+        return;
+    }
+    // a line is at most 2 + 32 + 1 (or 40 + 1) characters per field and the rule index
+    uint32_t lineSize = fieldWidths.size() * 48 + 16;
+    std::vector<char> buffer(std::max<uint32_t>(1 << 16, lineSize * 2));
+    char* last = buffer.data();
+    visitPackets(begin, end, [&](uint32_t, uint32_t flowId) {
+        if (last + lineSize > buffer.data() + buffer.size()) {
+            os.write(buffer.data(), last - buffer.data());
+            last = buffer.data();
+        }
+        last = style == RuleOutputStyle::FlowBench ? formatFlowBench(flowId, last) : formatClassBench(flowId, last);
+        std::string ruleIndex = ruleIndexes[flowId] == Flow::MISS_RULE_INDEX ? "-1" : std::to_string(ruleIndexes[flowId]);
+        memcpy(last, ruleIndex.data(), ruleIndex.size());
+        last += ruleIndex.size();
+        *last++ = '\n';
+    });
+    os.write(buffer.data(), last - buffer.data());
+}
+
+void Trace::printBinary(std::ostream& os, uint32_t begin, uint32_t end) const {
+    end = std::min(end, packetCount);
+    begin = std::min(begin, end);
+    // the timestamp and the rule index are followed by the header of the flow, which has the same layout as the record
+    const uint32_t alignment = BinaryTraceHeader::RECORD_ALIGNMENT;
+    const uint32_t prefixSize = sizeof(uint64_t) + sizeof(uint32_t);
+    uint32_t recordSize = (prefixSize + headerSize + alignment - 1) / alignment * alignment;
+    BinaryTraceHeader header;
+    memcpy(header.magic, BinaryTraceHeader::getMagic(), sizeof(header.magic));
+    header.version = BinaryTraceHeader::VERSION;
+    header.fieldCount = fieldWidths.size();
+    header.recordSize = recordSize;
+    header.dataOffset = sizeof(BinaryTraceHeader) + fieldWidths.size() * sizeof(BinaryTraceField);
+    header.dataOffset = (header.dataOffset + BinaryTraceHeader::DATA_ALIGNMENT - 1) / BinaryTraceHeader::DATA_ALIGNMENT *
+                        BinaryTraceHeader::DATA_ALIGNMENT;
+    header.packetCount = end - begin;
+    std::vector<char> buffer(header.dataOffset, 0);
+    memcpy(buffer.data(), &header, sizeof(header));
+    for (uint8_t i = 0; i < fieldWidths.size(); i++) {
+        BinaryTraceField field;
+        field.width = fieldWidths[i];
+        field.matchType = static_cast<uint8_t>(RuleTypeUD::getInstance().getMatchType(i));
+        field.offset = prefixSize + fieldOffsets[i];
+        memcpy(buffer.data() + sizeof(header) + i * sizeof(field), &field, sizeof(field));
+    }
+    os.write(buffer.data(), buffer.size());
+
+    uint32_t recordCount = std::max<uint32_t>(1, (1 << 16) / recordSize);
+    buffer.assign(static_cast<uint64_t>(recordCount) * recordSize, 0);
+    uint32_t count = 0;
+    visitTimedPackets(begin, end, [&](uint32_t, uint32_t flowId, uint64_t timestamp) {
+        char* record = buffer.data() + static_cast<uint64_t>(count) * recordSize;
+        memcpy(record, &timestamp, sizeof(uint64_t));
+        memcpy(record + sizeof(uint64_t), &ruleIndexes[flowId], sizeof(uint32_t));
+        memcpy(record + prefixSize, getHeader(flowId), headerSize);
+        if (++count == recordCount) {
+            os.write(buffer.data(), buffer.size());
+            count = 0;
+        }
+    });
+    os.write(buffer.data(), static_cast<uint64_t>(count) * recordSize);
+}
+
 }
\ No newline at end of file
@@ -4,49 +4,59 @@
 // we will allocate n traces to some flows according to the Pareto distribution
 // we will allocate n traces to some rules according to the Pareto distribution as well
 // and we will allocate the flows to the rules greedily
+// the result is stored in a FlowAllocation (one array for all the flows, see flow_allocation.hpp)
+// the traces which miss the rules (--miss-ratio) are allocated to the miss flows in the same way, without rules
 
 #include "pareto_allocator.hpp"
+#include "flow_allocation.hpp"
 #include "configuration_trace.hpp"
 
 namespace flowbench {
 
-class TraceAllocator : public Singleton<TraceAllocator> {
+class TraceAllocator : public ThreadLocalSingleton<TraceAllocator> {
 private:
     std::vector<uint32_t> ruleAllocation;
     std::vector<uint32_t> flowAllocation;
-    std::vector<std::vector<uint32_t>> ruleFlowAllocation;
+    FlowAllocation ruleFlowAllocation;
+    std::vector<uint32_t> missAllocation;
 
 public:
     TraceAllocator() = default;
 
-    std::vector<std::vector<uint32_t>>& operator()(uint32_t traceCount, uint32_t ruleCount);
+    FlowAllocation& operator()(uint32_t traceCount, uint32_t ruleCount);
+
+    // the trace count of every miss flow, allocated by the last call
+    const std::vector<uint32_t>& getMissAllocation() const {
+        return missAllocation;
+    }
 };
 
-std::vector<std::vector<uint32_t>>& TraceAllocator::operator()(uint32_t traceCount, uint32_t ruleCount) {
+FlowAllocation& TraceAllocator::operator()(uint32_t traceCount, uint32_t ruleCount) {
     ParetoAllocator& paretoAllocator = ParetoAllocator::getInstance();
+    ruleFlowAllocation.clear();
+    missAllocation.clear();
+    uint32_t missCount = TraceConfiguration::getInstance().getMissCount(traceCount);
+    traceCount -= missCount;
     if (TraceConfiguration::getInstance().enableFastMode()) {
-        flowAllocation = paretoAllocator.allocate(traceCount, UINT32_MAX, ParetoDistribution::flowDistribution);
-        ruleFlowAllocation.clear();
+        flowAllocation = paretoAllocator.allocate(traceCount, UINT32_MAX, TraceConfiguration::getInstance().getFlowDistribution());
+        // a flow joins the group of a random rule if the group exists, otherwise it starts a new group
+        std::vector<uint32_t> groupIndexes(flowAllocation.size());
+        uint32_t groupCount = 0;
         for (uint32_t i = 0; i < flowAllocation.size(); i++) {
             uint32_t ruleIndex = Random::getInstance().nextInt32(0, ruleCount - 1);
-            if (ruleFlowAllocation.size() <= ruleIndex) {
-                std::vector<uint32_t> allocation { flowAllocation[i] };
-                ruleFlowAllocation.push_back(allocation);
-            } else {
-                ruleFlowAllocation[ruleIndex].push_back(flowAllocation[i]);
-            }
+            groupIndexes[i] = groupCount <= ruleIndex ? groupCount++ : ruleIndex;
         }
+        ruleFlowAllocation.assign(flowAllocation, groupIndexes, groupCount);
     } else {    
-        ruleAllocation = paretoAllocator.allocate(traceCount, ruleCount, ParetoDistribution::ruleDistribution);
-        ruleFlowAllocation.clear();
-        ruleFlowAllocation.resize(ruleAllocation.size());
+        ruleAllocation = paretoAllocator.allocate(traceCount, ruleCount, TraceConfiguration::getInstance().getRuleDistribution());
         for (uint32_t i = 0; i < ruleAllocation.size(); i++) {
-            ruleFlowAllocation[i] = paretoAllocator.allocate(ruleAllocation[i], UINT32_MAX, ParetoDistribution::flowDistribution);
+            ruleFlowAllocation.push_back(paretoAllocator.allocate(ruleAllocation[i], UINT32_MAX, TraceConfiguration::getInstance().getFlowDistribution()));
         }
     }
-    std::sort(ruleFlowAllocation.begin(), ruleFlowAllocation.end(), [](const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
-        return a.size() > b.size();
-    });
+    if (missCount > 0) {
+        missAllocation = paretoAllocator.allocate(missCount, UINT32_MAX, TraceConfiguration::getInstance().getFlowDistribution());
+    }
+    ruleFlowAllocation.sortBySize();
     return ruleFlowAllocation;
 }
 
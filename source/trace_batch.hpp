@@ -0,0 +1,146 @@
+#pragma once
+
+// batch mode of the trace generator (--batch)
+// the user may want a lot of traces of the same rule set with different sizes, localities and seeds
+// if we run the trace generator once per trace, the rule pool is read and isolated again and again
+// in batch mode, every line of the batch file is a job, e.g.
+//     -n 100000 -rd 1 0.01 -fd 1 1 -s 1 -o trace_1
+//     -d 10 -rd 1 0.001 -s 2
+// a job accepts -n/-d, -rd, -fd, --temporal, --churn, --rate, --miss-ratio, --overlap-depth, -s and -o, the other parameters are shared (see TraceConfiguration)
+// the rule pool and the isolate rule set are built once and shared by the jobs read-only
+// the jobs run concurrently (see -t), every job has its own configuration and random engine
+// (see ThreadLocalSingleton), so a job writes the same file as the single run with the same parameters
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "trace_generator.hpp"
+#include "time_report.hpp"
+
+namespace flowbench {
+
+class TraceBatch : public Singleton<TraceBatch> {
+private:
+    // the parameters of every job
+    std::vector<std::vector<std::string>> jobs;
+
+    // the time and the number of relabeled flows of every job
+    std::vector<double> times;
+    std::vector<uint32_t> relabeledCounts;
+
+    // whether the isolate rule set is isolated (the isolation may fail, see rule_isolator.hpp)
+    bool isolated = true;
+
+    void readJobs(const std::string& path);
+
+    // run the jobIndex-th job on the current thread
+    void runJob(const TraceConfiguration& base, uint32_t jobIndex,
+                const UDRuleSetWithIndex* isolateRuleSet, const UDRuleSetWithIndex* originalRuleSet);
+
+public:
+    TraceBatch() = default;
+
+    // run all the jobs and print the result of every job
+    void run(std::ostream& os);
+};
+
+void TraceBatch::readJobs(const std::string& path) {
+    jobs.clear();
+    std::ifstream is(path);
+    if (!is) {
+        std::cerr << "Cannot open the batch file: " << path << std::endl;
+        exit(1);
+    }
+    std::string line;
+    while (std::getline(is, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        std::vector<std::string> parameters;
+        std::string parameter;
+        while (iss >> parameter) {
+            parameters.push_back(parameter);
+        }
+        if (!parameters.empty()) {
+            jobs.push_back(parameters);
+        }
+    }
+}
+
+void TraceBatch::runJob(const TraceConfiguration& base, uint32_t jobIndex,
+                        const UDRuleSetWithIndex* isolateRuleSet, const UDRuleSetWithIndex* originalRuleSet) {
+    TraceConfiguration::setInstance(base, jobs[jobIndex], jobIndex + 1);
+    auto& configuration = TraceConfiguration::getInstance();
+    Random::setInstance(configuration.getRandomSeed());
+    bool isolate = !configuration.enableFastMode() && !configuration.enableRejectionMode();
+    uint32_t relabeledCount = RejectionSampler::getInstance().getRelabeledCount();
+    std::ofstream os(configuration.getOutputFilePath(), configuration.enableBinaryOutput() || configuration.enablePcapOutput() ? std::ios::binary : std::ios::out);
+    times[jobIndex] = reportTime([&]() {
+        TraceGenerator::getInstance().generate(os, isolate ? *isolateRuleSet : *originalRuleSet);
+    });
+    os.close();
+    relabeledCounts[jobIndex] = RejectionSampler::getInstance().getRelabeledCount() - relabeledCount;
+}
+
+void TraceBatch::run(std::ostream& os) {
+    const auto& base = TraceConfiguration::getInstance();
+    readJobs(base.getBatchFilePath());
+    // the jobs are checked before running, and we only build the rule sets needed by the jobs
+    bool needIsolate = false;
+    bool needOriginal = false;
+    for (uint32_t i = 0; i < jobs.size(); i++) {
+        TraceConfiguration configuration(base, jobs[i], i + 1);
+        if (configuration.enableFastMode() || configuration.enableRejectionMode()) {
+            needOriginal = true;
+        } else {
+            needIsolate = true;
+        }
+    }
+    std::unique_ptr<UDRuleSetWithIndex> isolateRuleSet;
+    std::unique_ptr<UDRuleSetWithIndex> originalRuleSet;
+    if (needIsolate) {
+        isolateRuleSet = RuleIsolator::getInstance()(true);
+        isolated = isolateRuleSet->isIsolated();
+    }
+    if (needOriginal) {
+        originalRuleSet = RuleIsolator::getInstance()(false);
+    }
+    // the shared singletons are created before the jobs start
+    Configuration::getInstance();
+    RuleTypeUD::getInstance();
+    RulePool::getInstance();
+    RandomSelector::getInstance();
+    ParetoAllocator::getInstance();
+    TraceGenerator::getInstance();
+    times.assign(jobs.size(), 0.0);
+    relabeledCounts.assign(jobs.size(), 0);
+    std::atomic<uint32_t> next(0);
+    auto worker = [&]() {
+        for (uint32_t j = next++; j < jobs.size(); j = next++) {
+            runJob(base, j, isolateRuleSet.get(), originalRuleSet.get());
+        }
+    };
+    uint32_t threadCount = std::min<uint64_t>(base.getThreadCount(), jobs.size());
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (uint32_t i = 0; i < jobs.size(); i++) {
+        TraceConfiguration configuration(base, jobs[i], i + 1);
+        os << "Job " << i + 1 << ": " << configuration.getOutputFilePath()
+           << ", Trace Count: " << configuration.getTraceCount() << ", Time: " << times[i] << "s";
+        if (configuration.enableRejectionMode()) {
+            os << ", Relabeled Flows: " << relabeledCounts[i];
+        }
+        if (!configuration.enableFastMode() && !configuration.enableRejectionMode()) {
+            os << ", Rule Isolation: " << (isolated ? "Succeeded" : "Failed");
+        }
+        os << std::endl;
+    }
+}
+
+}
\ No newline at end of file
@@ -1,21 +1,64 @@
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 
 #include "rule_pool.hpp"
 #include "trace_generator.hpp"
+#include "trace_batch.hpp"
 #include "time_report.hpp"
 
+static void printCacheStatus(std::ostream& os) {
+    const auto& cache = flowbench::IsolationCache::getInstance();
+    os << "Isolation Cache: " << (cache.isHit() ? "Hit" : "Miss");
+    if (cache.isHit() && !cache.isIsolated()) {
+        os << " (the rules are not isolated)";
+    }
+    os << std::endl;
+}
+
 int main(int argc, char** argv) {
     flowbench::TraceConfiguration::setInstance(argc, argv);
-    std::ifstream is(flowbench::TraceConfiguration::getInstance().getInputFilePath());
-    flowbench::RulePool::setInstance(is);
+    auto& configuration = flowbench::TraceConfiguration::getInstance();
+    std::ifstream is(configuration.getInputFilePath(), std::ios::binary);
+    std::string input((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
     is.close();
+    // the rule pool is not needed if the isolate rule set is loaded from the cache
+    // (except in batch mode, some jobs may use the original rule pool,
+    // and the miss traffic and the overlap-targeted traffic are drawn against it)
+    if (configuration.enableCache() && flowbench::IsolationCache::getInstance().load(input, configuration.getCacheFilePath()) &&
+        !configuration.enableBatchMode() && !configuration.needRulePool()) {
+        configuration.setRuleCount(flowbench::IsolationCache::getInstance().getRuleCount());
+    } else {
+        std::istringstream iss(input);
+        flowbench::RulePool::setInstance(iss);
+    }
     flowbench::TraceConfiguration::getInstance().print(std::cout);
-    std::ofstream os(flowbench::TraceConfiguration::getInstance().getOutputFilePath());
+    if (configuration.enableBatchMode()) {
+        double time = flowbench::reportTime([&]() {
+            flowbench::TraceBatch::getInstance().run(std::cout);
+        });
+        std::cout << "Time: " << time << "s" << std::endl;
+        if (configuration.enableCache()) {
+            printCacheStatus(std::cout);
+        }
+        return 0;
+    }
+    std::ofstream os(configuration.getOutputFilePath(), configuration.enableBinaryOutput() || configuration.enablePcapOutput() ? std::ios::binary : std::ios::out);
+    bool isolated = false;
     double time = flowbench::reportTime([&]() {
-        flowbench::TraceGenerator::getInstance().generate(os);
+        isolated = flowbench::TraceGenerator::getInstance().generate(os);
     });
     os.close();
     std::cout << "Time: " << time << "s" << std::endl;
+    if (!configuration.enableFastMode() && !configuration.enableRejectionMode()) {
+        std::cout << "Rule Isolation: " << (isolated ? "Succeeded" : "Failed (the original rule pool is used)") << std::endl;
+    }
+    if (configuration.enableCache()) {
+        printCacheStatus(std::cout);
+    }
+    if (flowbench::TraceConfiguration::getInstance().enableRejectionMode()) {
+        std::cout << "Relabeled Flows: " << flowbench::RejectionSampler::getInstance().getRelabeledCount() << std::endl;
+    }
     return 0;
 }
\ No newline at end of file
@@ -5,11 +5,13 @@
 // 2. Trace Allocation, allocate the traces according to the Pareto distribution
 // 3. Rule Mapping, build a mapping between the allocation result and the isolate rule set
 // 4. Flow Mapping, build a mapping between the allocation result and the flows
+// in batch mode, the rule set of step 1 is shared by the jobs, and every job runs step 2 to 4 on its own thread
 
 #include "rule_isolator.hpp"
 #include "trace_allocator.hpp"
 #include "mapping_rule.hpp"
 #include "mapping_flow.hpp"
+#include "pcap_writer.hpp"
 #include "rule_output.hpp"
 
 namespace flowbench {
@@ -17,17 +19,36 @@ namespace flowbench {
 class TraceGenerator : public Singleton<TraceGenerator> {
 public:
     TraceGenerator() = default;
-    void generate(std::ostream& os) const;
+
+    // return whether the rule set is isolated (false in fast mode and rejection mode, or if the isolation fails)
+    bool generate(std::ostream& os) const;
+
+    // generate the traces from a rule set built by RuleIsolator (the rule set is not modified)
+    void generate(std::ostream& os, const UDRuleSetWithIndex& ruleSet) const;
 };
 
-void TraceGenerator::generate(std::ostream& os) const {
+bool TraceGenerator::generate(std::ostream& os) const {
+    bool isolate = !TraceConfiguration::getInstance().enableFastMode() &&
+                   !TraceConfiguration::getInstance().enableRejectionMode();
+    auto ruleSet = RuleIsolator::getInstance()(isolate);
+    generate(os, *ruleSet);
+    return ruleSet->isIsolated();
+}
+
+void TraceGenerator::generate(std::ostream& os, const UDRuleSetWithIndex& ruleSet) const {
     uint32_t traceCount = TraceConfiguration::getInstance().getTraceCount();
     uint32_t ruleCount = TraceConfiguration::getInstance().getRuleCount();
-    auto ruleSet = RuleIsolator::getInstance()();
     auto& ruleFlowAllocation = TraceAllocator::getInstance()(traceCount, ruleCount);
-    auto& rules = RuleMapping::getInstance()(*ruleSet, ruleFlowAllocation);
-    const auto& trace = FlowMapping::getInstance()(rules, ruleFlowAllocation);
-    trace.print(os);
+    auto& rules = RuleMapping::getInstance()(ruleSet, ruleFlowAllocation);
+    const auto& trace = FlowMapping::getInstance()(rules, ruleFlowAllocation, TraceAllocator::getInstance().getMissAllocation());
+    const auto& configuration = TraceConfiguration::getInstance();
+    if (configuration.enablePcapOutput()) {
+        PcapWriter(trace).write(os, configuration.getSliceBegin(), configuration.getSliceEnd());
+    } else if (configuration.enableBinaryOutput()) {
+        trace.printBinary(os, configuration.getSliceBegin(), configuration.getSliceEnd());
+    } else {
+        trace.print(os, configuration.getSliceBegin(), configuration.getSliceEnd());
+    }
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,195 @@
+#pragma once
+
+// the binary trace (for trace generator, --binary) and its reader
+// the text trace has to be parsed again by the classifier before replaying it
+// so the trace can also be written as fixed-size records, and the reader maps the file into memory
+// the records are read in place, so a replay loop reads the headers at memory bandwidth
+// file format (native byte order):
+//     magic "FBTRACE\0", version (4 bytes), field count (4 bytes), record size (4 bytes),
+//     data offset (4 bytes), packet count (8 bytes)
+//     for every field: width (1 byte), match type (1 byte), offset in the record (2 bytes)
+//     padding up to the data offset (a multiple of 64 bytes)
+//     for every packet: a record of record size bytes (a multiple of 8 bytes)
+//         the timestamp in nanoseconds from the first packet (8 bytes, see rate_model.hpp),
+//         the index of the rule expected to be hit (4 bytes, 0xffffffff for a miss), the value of every field, padding
+//         the value of a field of width w takes (w + 7) / 8 bytes in network byte order (big-endian)
+// this file only depends on the standard library and POSIX, so it can be copied into a classifier harness
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace flowbench {
+
+// the header may be included by several files of a harness, so nothing is defined out of the class
+// (the constants are only used as values, and the magic is returned by a function)
+struct BinaryTraceHeader {
+    constexpr static uint32_t VERSION = 2;
+    constexpr static uint32_t DATA_ALIGNMENT = 64;
+    constexpr static uint32_t RECORD_ALIGNMENT = 8;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t fieldCount;
+    uint32_t recordSize;
+    uint32_t dataOffset;
+    uint64_t packetCount;
+
+    static const char* getMagic() {
+        return "FBTRACE";
+    }
+};
+
+struct BinaryTraceField {
+    uint8_t width;
+    uint8_t matchType;
+    uint16_t offset;
+};
+
+static_assert(sizeof(BinaryTraceHeader) == 32 && sizeof(BinaryTraceField) == 4, "unexpected padding in the binary trace");
+
+// a record of the binary trace (a view of the mapped file)
+class TraceRecord {
+private:
+    const uint8_t* data;
+    const BinaryTraceField* fields;
+
+public:
+    TraceRecord(const uint8_t* data, const BinaryTraceField* fields) : data(data), fields(fields) {}
+
+    uint64_t getTimestamp() const {
+        uint64_t timestamp;
+        memcpy(&timestamp, data, sizeof(timestamp));
+        return timestamp;
+    }
+
+    uint32_t getRuleIndex() const {
+        uint32_t ruleIndex;
+        memcpy(&ruleIndex, data + sizeof(uint64_t), sizeof(ruleIndex));
+        return ruleIndex;
+    }
+
+    // the bytes of the index-th field (big-endian)
+    const uint8_t* getField(uint32_t index) const {
+        return data + fields[index].offset;
+    }
+
+    // the value of the index-th field, (high 64 bits, low 64 bits)
+    std::pair<uint64_t, uint64_t> getValue(uint32_t index) const {
+        const uint8_t* bytes = getField(index);
+        uint64_t high = 0;
+        uint64_t low = 0;
+        for (uint32_t j = 0; j < (fields[index].width + 7u) / 8; j++) {
+            high = high << 8 | low >> 56;
+            low = low << 8 | bytes[j];
+        }
+        return std::make_pair(high, low);
+    }
+};
+
+class TraceReader {
+private:
+    void* address = MAP_FAILED;
+    size_t size = 0;
+
+    const BinaryTraceHeader* header = nullptr;
+    const BinaryTraceField* fields = nullptr;
+    const uint8_t* records = nullptr;
+
+public:
+    TraceReader() = default;
+
+    TraceReader(const TraceReader& other) = delete;
+    TraceReader& operator=(const TraceReader& other) = delete;
+
+    ~TraceReader() {
+        close();
+    }
+
+    // map the binary trace into memory
+    // return false if the file cannot be mapped or it is not a binary trace of this version
+    bool open(const std::string& path);
+
+    void close();
+
+    uint64_t getPacketCount() const {
+        return header->packetCount;
+    }
+
+    uint32_t getFieldCount() const {
+        return header->fieldCount;
+    }
+
+    uint8_t getFieldWidth(uint32_t index) const {
+        return fields[index].width;
+    }
+
+    // the value of MatchType (see match_type.hpp)
+    uint8_t getMatchType(uint32_t index) const {
+        return fields[index].matchType;
+    }
+
+    uint32_t getRecordSize() const {
+        return header->recordSize;
+    }
+
+    // the first record, aligned to 64 bytes, the records are getRecordSize() bytes apart
+    const uint8_t* getRecords() const {
+        return records;
+    }
+
+    TraceRecord operator[](uint64_t packetIndex) const {
+        return TraceRecord(records + packetIndex * header->recordSize, fields);
+    }
+};
+
+inline bool TraceReader::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(BinaryTraceHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size = status.st_size;
+    address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping is kept after the file is closed
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    header = static_cast<const BinaryTraceHeader*>(address);
+    fields = reinterpret_cast<const BinaryTraceField*>(header + 1);
+    records = static_cast<const uint8_t*>(address) + header->dataOffset;
+    // the header is not trusted, so the size of the records is checked by a division (the product may overflow)
+    if (memcmp(header->magic, BinaryTraceHeader::getMagic(), sizeof(header->magic)) != 0 ||
+        header->version != BinaryTraceHeader::VERSION || header->recordSize == 0 ||
+        header->dataOffset < sizeof(BinaryTraceHeader) + static_cast<uint64_t>(header->fieldCount) * sizeof(BinaryTraceField) ||
+        header->dataOffset > size || header->packetCount > (size - header->dataOffset) / header->recordSize) { // truncated
+        close();
+        return false;
+    }
+    madvise(address, size, MADV_SEQUENTIAL);
+    return true;
+}
+
+inline void TraceReader::close() {
+    if (address != MAP_FAILED) {
+        munmap(address, size);
+    }
+    address = MAP_FAILED;
+    size = 0;
+    header = nullptr;
+    fields = nullptr;
+    records = nullptr;
+}
+
+}
\ No newline at end of file
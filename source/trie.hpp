@@ -6,7 +6,14 @@
 // then we use Trie to generate the virtual rules
 // to generate the complete QuadDag profile
 
-#include <functional>
+// the Trie is implicit: a node is identified by its heap index
+// the root is 1, and the children of node i are 2i and 2i+1
+// so the node i at depth d represents the prefix (i - 2^d) of length d
+// and we only need to store whether a node exists
+// NOTE: the fields of the candidate rules are short (at most MAX_BIT_WIDTH bits)
+//       so the array (2^(d+1) entries for depth d) is tiny
+
+#include <vector>
 
 #include "match_field_lpm.hpp"
 #include "int32.hpp"
@@ -15,26 +22,14 @@ namespace flowbench {
 
 class Trie {
 private:
-    class TrieNode {
-    public:
-        LpmField<Int32> field;
-        std::array<std::shared_ptr<TrieNode>, 2> children;
-
-        TrieNode() : field(0, 0) {
-            children[0] = nullptr;
-            children[1] = nullptr;
-        }
-
-        TrieNode(const Int32& prefix, uint8_t prefixLength) : field(prefix, prefixLength) {
-            children[0] = nullptr;
-            children[1] = nullptr;
-        }
-    };
-
-    std::shared_ptr<TrieNode> root;
+    // present[i]: whether the node with heap index i exists
+    // the children of a node are always created together
+    std::vector<bool> present;
 
 public:
-    Trie(): root(std::make_shared<TrieNode>()) {}
+    Trie(): present(2, false) {
+        present[1] = true;
+    }
 
     Trie(const Trie& other) = delete;
     Trie(Trie&& other) = default;
@@ -42,50 +37,67 @@ public:
     Trie& operator=(Trie&& other) = default;
 
     void clear() {
-        root = std::make_shared<TrieNode>();
+        present.assign(2, false);
+        present[1] = true;
     }
     
 public:
     // insert a field into the Trie
     void insert(const LpmField<Int32>& field);
 
-    // traverse all the leaves
-    void traverse(std::function<void(const LpmField<Int32>&)> callback) const {
-        traverse(root, callback);
-    }
+    // traverse all the leaves (from left to right)
+    template <typename Callback>
+    void traverse(Callback&& callback) const;
 
 private:
-    void traverse(std::shared_ptr<TrieNode> node, std::function<void(const LpmField<Int32>&)> callback) const;
+    bool hasChildren(uint32_t node) const {
+        return 2 * node < present.size() && present[2 * node];
+    }
+
+    // the field represented by the node
+    static LpmField<Int32> fieldOf(uint32_t node);
 };
 
 void Trie::insert(const LpmField<Int32>& field) {
-    auto node = root;
-    Int32 prefix = 0, mask = getHighestBitOf<Int32>();
-    for (uint8_t i = 1; i <= field.getPrefixLength(); i++) {
-        if (node->children[0] == nullptr) {
-            node->children[0] = std::make_shared<TrieNode>(prefix, i);
-        }
-        if (node->children[1] == nullptr) {
-            node->children[1] = std::make_shared<TrieNode>(prefix | mask, i);
-        }
-        if (!(field.getPrefix() & mask).isZero()) {
-            prefix |= mask;
-            node = node->children[1];
-        } else {
-            node = node->children[0];
-        }
+    uint8_t length = field.getPrefixLength();
+    if (present.size() < (2ull << length)) {
+        present.resize(2ull << length, false);
+    }
+    uint32_t node = 1;
+    Int32 mask = getHighestBitOf<Int32>();
+    for (uint8_t i = 1; i <= length; i++) {
+        present[2 * node] = true;
+        present[2 * node + 1] = true;
+        node = 2 * node + ((field.getPrefix() & mask).isZero() ? 0 : 1);
         mask >>= 1;
     }
 }
 
-void Trie::traverse(std::shared_ptr<TrieNode> node, std::function<void(const LpmField<Int32>&)> callback) const {
-    if (node->children[0] == nullptr && node->children[1] == nullptr) {
-        callback(node->field);
-    } else {
-        traverse(node->children[0], callback);
-        traverse(node->children[1], callback);
+template <typename Callback>
+void Trie::traverse(Callback&& callback) const {
+    std::vector<uint32_t> stack = {1};
+    while (!stack.empty()) {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        if (!hasChildren(node)) {
+            callback(fieldOf(node));
+        } else {
+            stack.push_back(2 * node + 1);
+            stack.push_back(2 * node);
+        }
     }
 }
 
+LpmField<Int32> Trie::fieldOf(uint32_t node) {
+    uint8_t depth = 0;
+    while ((node >> (depth + 1)) != 0) {
+        depth++;
+    }
+    if (depth == 0) {
+        return LpmField<Int32>(0, 0);
+    }
+    uint32_t prefix = (node - (1u << depth)) << (32 - depth);
+    return LpmField<Int32>(Int32(prefix), depth);
+}
 
 }
\ No newline at end of file
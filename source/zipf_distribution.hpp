@@ -0,0 +1,108 @@
+#pragma once
+
+// we use Zipf distribution to control the spatial locality of the traces (-rd zipf:s, -fd zipf:s)
+// the copy count k is in [1, N], and P(k) is proportional to k^(-s)
+// traffic studies usually quote the exponent s, so the user may specify it directly
+// the counts are drawn by rejection-inversion, which takes O(1) expected time for any N and s > 0
+//     W. Hormann, G. Derflinger, Rejection-inversion to generate variates from monotone discrete distributions, 1996
+// the idea is to draw x from the continuous density h(x) = x^(-s) by inversion
+// and accept k = round(x) if x falls into the part of [k - 0.5, k + 0.5] whose area is h(k)
+// most draws are accepted without evaluating any transcendental function (the squeeze with threshold)
+
+#include <cmath>
+
+#include "count_distribution.hpp"
+
+namespace flowbench {
+
+class ZipfDistribution : public CountDistribution {
+private:
+    double s;
+    uint32_t n;
+
+    double hIntegralX1;
+    double hIntegralN;
+    double threshold;
+
+    double h(double x) const {
+        return std::exp(-s * std::log(x));
+    }
+
+    // the integral of h, (x^(1 - s) - 1) / (1 - s) (log(x) if s = 1)
+    double hIntegral(double x) const {
+        double logX = std::log(x);
+        return helper2((1.0 - s) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        double t = x * (1.0 - s);
+        if (t < -1.0) { // rounding error
+            t = -1.0;
+        }
+        return std::exp(helper1(t) * x);
+    }
+
+    // log(1 + x) / x, accurate near 0
+    static double helper1(double x) {
+        if (std::fabs(x) > 1e-8) {
+            return std::log1p(x) / x;
+        }
+        return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+
+    // (exp(x) - 1) / x, accurate near 0
+    static double helper2(double x) {
+        if (std::fabs(x) > 1e-8) {
+            return std::expm1(x) / x;
+        }
+        return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+    }
+
+    uint32_t sample(UniformSource& source) const;
+
+public:
+    constexpr static uint32_t DEFAULT_MAX_COUNT = 1000000;
+
+    ZipfDistribution(double s, uint32_t n = DEFAULT_MAX_COUNT);
+
+    using CountDistribution::fill;
+    void fill(std::vector<uint32_t>& block, UniformSource& source) const override {
+        for (auto& count : block) {
+            count = sample(source);
+        }
+    }
+
+    void print(std::ostream& os) const override {
+        os << "Zipf(" << s << ", " << n << ")";
+    }
+
+    std::unique_ptr<CountDistribution> clone() const override {
+        return std::make_unique<ZipfDistribution>(s, n);
+    }
+};
+
+constexpr uint32_t ZipfDistribution::DEFAULT_MAX_COUNT;
+
+ZipfDistribution::ZipfDistribution(double s, uint32_t n) : s(s), n(n) {
+    hIntegralX1 = hIntegral(1.5) - 1.0;
+    hIntegralN = hIntegral(n + 0.5);
+    threshold = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+}
+
+uint32_t ZipfDistribution::sample(UniformSource& source) const {
+    while (true) {
+        double u = hIntegralN + source.nextDouble(0.0, 1.0) * (hIntegralX1 - hIntegralN);
+        double x = hIntegralInverse(u);
+        double k = std::floor(x + 0.5);
+        if (k < 1.0) {
+            k = 1.0;
+        } else if (k > n) {
+            k = n;
+        }
+        if (k - x <= threshold || u >= hIntegral(k + 0.5) - h(k)) {
+            return static_cast<uint32_t>(k);
+        }
+    }
+}
+
+}
\ No newline at end of file